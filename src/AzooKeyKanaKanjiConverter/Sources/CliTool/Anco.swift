@@ -12,6 +12,7 @@ struct Anco: AsyncParsableCommand {
             Subcommands.ZenzEvaluate.self,
             Subcommands.Session.self,
             Subcommands.ExperimentalPredict.self,
+            Subcommands.NBestBench.self,
             Subcommands.NGram.self
         ],
         defaultSubcommand: Subcommands.Run.self
@@ -0,0 +1,62 @@
+import ArgumentParser
+import Foundation
+import KanaKanjiConverterModule
+
+extension Subcommands.Dict {
+    struct Bench: ParsableCommand {
+        @Option(name: [.customLong("dictionary_dir"), .customShort("d")], help: "The directory for dictionary data.")
+        var dictionaryDirectory: String = "./"
+
+        @Option(name: [.customLong("iterations"), .customShort("n")], help: "Number of passes over all nodes.")
+        var iterations: Int = 10
+
+        static let configuration = CommandConfiguration(
+            commandName: "bench",
+            abstract: "Benchmark LOUDS child node lookup against the binary-search implementation"
+        )
+
+        mutating func run() throws {
+            let loudsDirectory = URL(fileURLWithPath: self.dictionaryDirectory).appendingPathComponent("louds", isDirectory: true)
+            let identifiers = try FileManager.default.contentsOfDirectory(at: loudsDirectory, includingPropertiesForKeys: nil)
+                .filter { $0.pathExtension == "louds" }
+                .map { $0.deletingPathExtension().lastPathComponent }
+                .sorted()
+            let loudses = identifiers.compactMap { LOUDS.load($0, dictionaryURL: URL(fileURLWithPath: self.dictionaryDirectory)) }
+            // 実際の辞書引きと同じく、各ノードから子ノードを求める
+            let queries = loudses.map { [1] + $0.prefixNodeIndices(chars: [], maxDepth: .max, maxCount: .max) }
+            let queryCount = queries.reduce(0) { $0 + $1.count } * self.iterations
+            guard queryCount > 0 else {
+                print("LOUDS data was not found in \(loudsDirectory.path)")
+                return
+            }
+
+            func measure(_ body: (LOUDS, Int) -> Range<Int>) -> (seconds: Double, checksum: Int) {
+                var checksum = 0
+                let start = Date()
+                for _ in 0 ..< self.iterations {
+                    for (louds, nodeIndices) in zip(loudses, queries) {
+                        for nodeIndex in nodeIndices {
+                            let range = body(louds, nodeIndex)
+                            checksum &+= range.lowerBound &+ range.count
+                        }
+                    }
+                }
+                return (Date().timeIntervalSince(start), checksum)
+            }
+            let baseline = measure { $0.childNodeIndicesByBinarySearch(from: $1) }
+            let select = measure { $0.childNodeIndices(from: $1) }
+            print(
+                """
+                \(bold: "=== LOUDS childNodeIndices benchmark ===")
+                - directory: \(self.dictionaryDirectory)
+                - files: \(loudses.count)
+                - queries: \(queryCount)
+                - binary search: \(baseline.seconds * 1e9 / Double(queryCount)) ns/query
+                - select index: \(select.seconds * 1e9 / Double(queryCount)) ns/query
+                - speedup: \(baseline.seconds / select.seconds)x
+                - results match: \(baseline.checksum == select.checksum)
+                """
+            )
+        }
+    }
+}
@@ -4,7 +4,7 @@ import KanaKanjiConverterModule
 import OrderedCollections
 
 extension Subcommands.Dict {
-    struct Build: ParsableCommand {
+    struct Build: AsyncParsableCommand {
         static let configuration = CommandConfiguration(commandName: "build", abstract: "Build louds dictionary files and cost files from source files.")
         private static let targetChars = [
             "￣", "‐", "―", "〜", "・", "、", "…", "‥", "。", "‘", "’", "“", "”", "〈", "〉", "《", "》", "「", "」", "『", "』", "【", "】", "〔", "〕", "‖", "*", "′", "〃", "※", "´", "¨", "゛", "゜", "←", "→", "↑", "↓", "─", "■", "□", "▲", "△", "▼", "▽", "◆", "◇", "○", "◎", "●", "★", "☆", "々", "ゝ", "ヽ", "ゞ", "ヾ", "ー", "〇", "ァ", "ア", "ィ", "イ", "ゥ", "ウ", "ヴ", "ェ", "エ", "ォ", "オ", "ヵ", "カ", "ガ", "キ", "ギ", "ク", "グ", "ヶ", "ケ", "ゲ", "コ", "ゴ", "サ", "ザ", "シ", "ジ", "〆", "ス", "ズ", "セ", "ゼ", "ソ", "ゾ", "タ", "ダ", "チ", "ヂ", "ッ", "ツ", "ヅ", "テ", "デ", "ト", "ド", "ナ", "ニ", "ヌ", "ネ", "ノ", "ハ", "バ", "パ", "ヒ", "ビ", "ピ", "フ", "ブ", "プ", "ヘ", "ベ", "ペ", "ホ", "ボ", "ポ", "マ", "ミ", "ム", "メ", "モ", "ヤ", "ユ", "ョ", "ヨ", "ラ", "リ", "ル", "レ", "ロ", "ヮ", "ワ", "ヰ", "ヱ", "ヲ", "ン", "仝", "0", "1", "2", "3", "4", "5", "6", "7", "8", "9", "！", "？", "(", ")", "#", "%", "&", "^", "_", "'", "\"", "=", "ㇻ"
@@ -21,11 +21,20 @@ extension Subcommands.Dict {
 
         @Flag(name: [.customShort("v"), .customLong("verbose")], help: "Verbose logs.")
         var verbose = false
+
+        @Flag(name: [.customShort("u"), .customLong("unified")], help: "Writes a single combined LOUDS trie instead of one trie per first character.")
+        var unified = false
+
+        @Flag(name: [.customShort("m"), .customLong("cc_matrix")], help: "Also writes a dense, memory-mappable connection cost matrix `cb/matrix.ccm`.")
+        var connectionCostMatrix = false
+
+        @Option(name: [.customShort("j"), .customLong("jobs")], help: "Number of tries built in parallel. Use 1 for the serial builder.")
+        var jobs: Int = ProcessInfo.processInfo.activeProcessorCount
     }
 }
 
 extension Subcommands.Dict.Build {
-    mutating func run() throws {
+    mutating func run() async throws {
         let sourceDirectoryURL = URL(fileURLWithPath: self.workingDirectory, isDirectory: true).appending(path: "worddict", directoryHint: .isDirectory)
         let targetDirectoryURL = URL(fileURLWithPath: self.workingDirectory, isDirectory: true).appending(path: "louds", directoryHint: .isDirectory)
         if self.cleanTargetDirectory {
@@ -62,13 +71,39 @@ extension Subcommands.Dict.Build {
                 allEntries.append(DicdataElement(word: word, ruby: ruby, lcid: lcid, rcid: rcid, mid: mid, value: PValue(score)))
             }
         }
-        try DictionaryBuilder.exportDictionary(
-            entries: allEntries,
-            to: targetDirectoryURL,
-            baseName: "",
-            shardByFirstCharacter: true,
-            char2UInt8: Self.char2UInt8
-        )
+        if self.unified {
+            try DictionaryBuilder.exportUnifiedDictionary(
+                entries: allEntries,
+                to: targetDirectoryURL,
+                char2UInt8: Self.char2UInt8
+            )
+        } else if self.jobs <= 1 {
+            try DictionaryBuilder.exportDictionary(
+                entries: allEntries,
+                to: targetDirectoryURL,
+                baseName: "",
+                shardByFirstCharacter: true,
+                char2UInt8: Self.char2UInt8
+            )
+        } else {
+            let metrics = try await DictionaryBuilder.exportDictionaryConcurrently(
+                entries: allEntries,
+                to: targetDirectoryURL,
+                char2UInt8: Self.char2UInt8,
+                maxConcurrency: self.jobs
+            )
+            print(
+                """
+                - jobs: \(self.jobs)
+                - tries: \(metrics.trieCount)
+                - entries: \(metrics.entryCount)
+                - files: \(metrics.fileCount)
+                - bytes: \(metrics.byteCount)
+                - elapsed: \(metrics.elapsedSeconds) s
+                - parallelism: \(metrics.trieSeconds / max(metrics.elapsedSeconds, .ulpOfOne))x
+                """
+            )
+        }
         print("Add charID.chid file...")
         try Self.writeCharID(targetDirectory: targetDirectoryURL)
         if addGitKeepFile {
@@ -93,6 +128,10 @@ extension Subcommands.Dict.Build {
         let builder = CostBuilder(workDirectory: workDirectoryURL)
         print("Generates binary files into \(workDirectoryURL.path)...")
         try builder.build()
+        if self.connectionCostMatrix {
+            print("Generates connection cost matrix into \(workDirectoryURL.appendingPathComponent("cb", isDirectory: true).path)...")
+            try DictionaryBuilder.exportConnectionCostMatrix(dictionaryURL: workDirectoryURL)
+        }
         if self.addGitKeepFile {
             print("Adds .gitkeep file into \(workDirectoryURL.path)...")
             try builder.writeGitKeep()
@@ -0,0 +1,91 @@
+import ArgumentParser
+import Foundation
+import KanaKanjiConverterModuleWithDefaultDictionary
+
+extension Subcommands {
+    struct NBestBench: ParsableCommand {
+        @Argument(help: "ひらがなで表記された入力。省略した場合は組み込みの入力を用いる")
+        var inputs: [String] = []
+
+        @Option(name: [.customLong("n_best")], parsing: .upToNextOption, help: "N_best values to measure.")
+        var nBestValues: [Int] = [2, 3, 10]
+
+        @Option(name: [.customLong("iterations"), .customShort("n")], help: "Number of passes over all inputs.")
+        var iterations: Int = 5
+
+        static let configuration = CommandConfiguration(
+            commandName: "bench_nbest",
+            abstract: "Benchmark lattice construction while typing inputs one character at a time, for each N_best"
+        )
+
+        private static let defaultInputs = [
+            "わがはいはねこである",
+            "なまえはまだない",
+            "どこでうまれたかとんとけんとうがつかぬ",
+            "きょうはいいてんきですね",
+            "あしたのかいぎはごごさんじからです",
+            "しんかんせんのきっぷをよやくしました",
+        ]
+
+        func requestOptions(nBest: Int) -> ConvertRequestOptions {
+            var option: ConvertRequestOptions = .init(
+                N_best: nBest,
+                requireJapanesePrediction: false,
+                requireEnglishPrediction: false,
+                keyboardLanguage: .ja_JP,
+                englishCandidateInRoman2KanaInput: true,
+                fullWidthRomanCandidate: false,
+                halfWidthKanaCandidate: false,
+                learningType: .nothing,
+                maxMemoryCount: 0,
+                shouldResetMemory: false,
+                memoryDirectoryURL: URL(fileURLWithPath: ""),
+                sharedContainerURL: URL(fileURLWithPath: ""),
+                textReplacer: .empty,
+                specialCandidateProviders: [],
+                metadata: .init(versionString: "anco for debugging")
+            )
+            option.requestQuery = .完全一致
+            return option
+        }
+
+        mutating func run() throws {
+            let inputs = self.inputs.isEmpty ? Self.defaultInputs : self.inputs
+            let converter = KanaKanjiConverter.withDefaultDictionary()
+            // 辞書の読み込みを計測に含めないよう、一度変換しておく
+            for input in inputs {
+                var composingText = ComposingText()
+                composingText.insertAtCursorPosition(input, inputStyle: .direct)
+                _ = converter.requestCandidates(composingText, options: self.requestOptions(nBest: 1))
+                converter.stopComposition()
+            }
+            let keystrokes = inputs.reduce(0) { $0 + $1.count } * self.iterations
+            print(
+                """
+                \(bold: "=== N-best lattice construction benchmark ===")
+                - inputs: \(inputs.count)
+                - keystrokes: \(keystrokes)
+                """
+            )
+            for nBest in self.nBestValues {
+                let options = self.requestOptions(nBest: nBest)
+                var checksum = 0
+                let start = Date()
+                for _ in 0 ..< self.iterations {
+                    for input in inputs {
+                        // 1文字ずつ入力し、打鍵ごとに差分更新で変換する
+                        var composingText = ComposingText()
+                        for char in input {
+                            composingText.insertAtCursorPosition(String(char), inputStyle: .direct)
+                            let result = converter.requestCandidates(composingText, options: options)
+                            checksum &+= result.mainResults.count
+                        }
+                        converter.stopComposition()
+                    }
+                }
+                let seconds = Date().timeIntervalSince(start)
+                print("- N_best=\(nBest): \(seconds * 1e6 / Double(keystrokes)) µs/keystroke (candidates: \(checksum))")
+            }
+        }
+    }
+}
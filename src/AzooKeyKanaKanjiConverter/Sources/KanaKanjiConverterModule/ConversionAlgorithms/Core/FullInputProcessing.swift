@@ -15,6 +15,7 @@ extension Kana2Kanji {
     /// - Parameters:
     ///   - inputData: 入力データ。
     ///   - N_best: N_best。
+    ///   - cancellation: 別スレッドから変換を中断するためのフラグ。中断された場合は途中までの結果を返す。
     /// - Returns:
     ///   変換候補。
     /// ### 実装状況
@@ -32,19 +33,24 @@ extension Kana2Kanji {
         N_best: Int,
         needTypoCorrection: Bool,
         preprocessedLattice: Lattice? = nil,
-        dicdataStoreState: DicdataStoreState
+        dicdataStoreState: DicdataStoreState,
+        cancellation: ConversionCancellation? = nil
     ) -> (result: LatticeNode, lattice: Lattice) {
+        let measureStart = LatencyHistogram.now()
+        defer {
+            ConversionStatistics.latticeConstruction.record(since: measureStart)
+        }
         debug("新規に計算を行います。inputされた文字列は\(inputData.input.count)文字分の\(inputData.convertTarget)")
         let result: LatticeNode = LatticeNode.EOSNode
         let inputCount: Int = inputData.input.count
         let surfaceCount = inputData.convertTarget.count
-        let indexMap = LatticeDualIndexMap(inputData)
+        let indexMap = self.indexMapCache.indexMap(for: inputData)
         let latticeIndices = indexMap.indices(inputCount: inputCount, surfaceCount: surfaceCount)
         let lattice: Lattice
         if let preprocessedLattice {
             lattice = preprocessedLattice
         } else {
-            let rawNodes = latticeIndices.map { index in
+            let ranges: [DicdataStore.LookupRange] = latticeIndices.map { index in
                 let inputRange: (startIndex: Int, endIndexRange: Range<Int>?)? = if let iIndex = index.inputIndex {
                     (iIndex, nil)
                 } else {
@@ -55,22 +61,28 @@ extension Kana2Kanji {
                 } else {
                     nil
                 }
-                return dicdataStore.lookupDicdata(
-                    composingText: inputData,
-                    inputRange: inputRange,
-                    surfaceRange: surfaceRange,
-                    needTypoCorrection: needTypoCorrection,
-                    state: dicdataStoreState
-                )
+                return (inputRange, surfaceRange)
             }
+            // 開始位置ごとの辞書引きは独立しているため、長い入力では並列に行われる
+            let rawNodes = dicdataStore.lookupDicdata(
+                composingText: inputData,
+                ranges: ranges,
+                needTypoCorrection: needTypoCorrection,
+                state: dicdataStoreState
+            )
             lattice = Lattice(
                 inputCount: inputCount,
                 surfaceCount: surfaceCount,
                 rawNodes: rawNodes
             )
         }
+        var successors = LatticeSuccessorBatches(lattice: lattice, dicdataStore: self.dicdataStore)
         // 「i文字目から始まるnodes」に対して
         for (isHead, nodeArray) in lattice.indexedNodes(indices: latticeIndices) {
+            // 中断された場合は途中までの結果を返す。結果は呼び出し側で破棄される
+            if cancellation?.isCancelled == true {
+                break
+            }
             // それぞれのnodeに対して
             for node in nodeArray {
                 if node.prevs.isEmpty {
@@ -83,7 +95,7 @@ extension Kana2Kanji {
                 let wValue: PValue = node.data.value()
                 if isHead {
                     // valuesを更新する
-                    node.values = node.prevs.map {$0.totalValue + wValue + self.dicdataStore.getCCValue($0.data.rcid, node.data.lcid)}
+                    node.values = node.prevs.map {$0.totalValue + wValue + self.connectionCosts.value($0.data.rcid, node.data.lcid)}
                 } else {
                     // valuesを更新する
                     node.values = node.prevs.map {$0.totalValue + wValue}
@@ -94,7 +106,7 @@ extension Kana2Kanji {
                 if nextIndex.surfaceIndex == surfaceCount {
                     self.updateResultNode(with: node, resultNode: result)
                 } else {
-                    self.updateNextNodes(with: node, nextNodes: lattice[index: nextIndex], nBest: N_best)
+                    self.updateNextNodes(with: node, successors: &successors, at: nextIndex, nBest: N_best)
                 }
             }
         }
@@ -103,34 +115,28 @@ extension Kana2Kanji {
 
     func updateResultNode(with node: LatticeNode, resultNode: LatticeNode) {
         for index in node.prevs.indices {
-            let newnode: RegisteredNode = node.getRegisteredNode(index, value: node.values[index])
+            let newnode: RegisteredNode = node.getRegisteredNode(index, value: node.values[index], arena: self.latticeArena)
             resultNode.prevs.append(newnode)
         }
     }
     /// N-Best計算を高速に実行しつつ、遷移先ノードを更新する
-    func updateNextNodes(with node: LatticeNode, nextNodes: some Sequence<LatticeNode>, nBest: Int) {
-        let ccLatter = self.dicdataStore.getCCLatter(node.data.rcid)
-        for nextnode in nextNodes {
-            if self.dicdataStore.shouldBeRemoved(data: nextnode.data) {
+    ///
+    /// 遷移先ノードには上位`nBest`件の経路だけを`NBestBuffer`で保持し、`RegisteredNode`の作成は遷移先の`prevs`が参照されるまで遅延する。
+    /// 連接確率は遷移先ごとに引くのではなく、`successors`にまとめた`lcid`の列から一度に求める。
+    func updateNextNodes(with node: LatticeNode, successors: inout LatticeSuccessorBatches, at nextIndex: LatticeDualIndexMap.DualIndex, nBest: Int) {
+        let batch = successors.batch(at: nextIndex)
+        guard !batch.nodes.isEmpty, let bestValue = node.values.max() else {
+            return
+        }
+        self.dicdataStore.getCCLatter(node.data.rcid).gather(batch.lcids, into: &successors.scores)
+        for (nextnode, ccValue) in zip(batch.nodes, successors.scores) {
+            // 最も良い経路でも上位に入らない遷移先は、prevnodeごとの比較を行わずに除く
+            if let threshold = nextnode.pendingPathThreshold(nBest: nBest), ccValue + bestValue <= threshold {
                 continue
             }
-            // クラスの連続確率を計算する。
-            let ccValue: PValue = ccLatter.get(nextnode.data.lcid)
             // nodeの持っている全てのprevnodeに対して
             for (index, value) in node.values.enumerated() {
-                let newValue: PValue = ccValue + value
-                // 追加すべきindexを取得する
-                let lastindex: Int = (nextnode.prevs.lastIndex(where: {$0.totalValue >= newValue}) ?? -1) + 1
-                if lastindex == nBest {
-                    continue
-                }
-                let newnode: RegisteredNode = node.getRegisteredNode(index, value: newValue)
-                // カウントがオーバーしている場合は除去する
-                if nextnode.prevs.count >= nBest {
-                    nextnode.prevs.removeLast()
-                }
-                // removeしてからinsertした方が速い (insertはO(N)なので)
-                nextnode.prevs.insert(newnode, at: lastindex)
+                nextnode.addPendingPath(from: node, index: index, value: ccValue + value, nBest: nBest, arena: self.latticeArena)
             }
         }
     }
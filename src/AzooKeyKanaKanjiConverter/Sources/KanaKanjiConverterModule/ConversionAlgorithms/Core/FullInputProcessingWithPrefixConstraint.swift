@@ -64,6 +64,7 @@ extension Kana2Kanji {
     /// - Parameters:
     ///   - inputData: 入力データ。
     ///   - N_best: N_best。
+    ///   - cancellation: 別スレッドから変換を中断するためのフラグ。中断された場合は途中までの結果を返す。
     /// - Returns:
     ///   変換候補。
     /// ### 実装状況
@@ -81,13 +82,18 @@ extension Kana2Kanji {
         N_best: Int,
         constraint: PrefixConstraint,
         preprocessedLattice: Lattice? = nil,
-        dicdataStoreState: DicdataStoreState
+        dicdataStoreState: DicdataStoreState,
+        cancellation: ConversionCancellation? = nil
     ) -> (result: LatticeNode, lattice: Lattice) {
+        let measureStart = LatencyHistogram.now()
+        defer {
+            ConversionStatistics.latticeConstruction.record(since: measureStart)
+        }
         debug("新規に計算を行います。inputされた文字列は\(inputData.input.count)文字分の\(inputData.convertTarget)。制約は\(constraint)")
         let result: LatticeNode = LatticeNode.EOSNode
         let inputCount: Int = inputData.input.count
         let surfaceCount = inputData.convertTarget.count
-        let indexMap = LatticeDualIndexMap(inputData)
+        let indexMap = self.indexMapCache.indexMap(for: inputData)
         let latticeIndices = indexMap.indices(inputCount: inputCount, surfaceCount: surfaceCount)
         let lattice: Lattice
         if let preprocessedLattice {
@@ -120,6 +126,10 @@ extension Kana2Kanji {
         }
         // 「i文字目から始まるnodes」に対して
         for (isHead, nodeArray) in lattice.indexedNodes(indices: latticeIndices) {
+            // 中断された場合は途中までの結果を返す。結果は呼び出し側で破棄される
+            if cancellation?.isCancelled == true {
+                break
+            }
             // それぞれのnodeに対して
             for node in nodeArray {
                 if node.prevs.isEmpty {
@@ -129,7 +139,7 @@ extension Kana2Kanji {
                 let wValue: PValue = node.data.value()
                 if isHead {
                     // valuesを更新する
-                    node.values = node.prevs.map {$0.totalValue + wValue + self.dicdataStore.getCCValue($0.data.rcid, node.data.lcid)}
+                    node.values = node.prevs.map {$0.totalValue + wValue + self.connectionCosts.value($0.data.rcid, node.data.lcid)}
                 } else {
                     // valuesを更新する
                     node.values = node.prevs.map {$0.totalValue + wValue}
@@ -158,7 +168,7 @@ extension Kana2Kanji {
                                 continue
                             }
                         }
-                        let newnode: RegisteredNode = node.getRegisteredNode(index, value: node.values[index])
+                        let newnode: RegisteredNode = node.getRegisteredNode(index, value: node.values[index], arena: self.latticeArena)
                         result.prevs.append(newnode)
                     }
                 } else {
@@ -214,7 +224,7 @@ extension Kana2Kanji {
                             if nextnode.prevs.count >= N_best {
                                 nextnode.prevs.removeLast()
                             }
-                            let newnode: RegisteredNode = node.getRegisteredNode(index, value: newValue)
+                            let newnode: RegisteredNode = node.getRegisteredNode(index, value: newValue, arena: self.latticeArena)
                             // removeしてからinsertした方が速い (insertはO(N)なので)
                             nextnode.prevs.insert(newnode, at: lastindex)
                         }
@@ -233,7 +243,7 @@ extension Kana2Kanji {
         incrementalCacheInfo: (inputData: ComposingText, lattice: Lattice)?,
         dicdataStoreState: DicdataStoreState,
         ) -> Lattice {
-        let indexMap = LatticeDualIndexMap(inputData)
+        let indexMap = self.indexMapCache.indexMap(for: inputData)
         let latticeIndices = indexMap.indices(inputCount: inputCount, surfaceCount: surfaceCount)
         guard let incrementalCacheInfo else {
             // キャッシュがない場合は通常の辞書引き
@@ -16,7 +16,13 @@ extension Kana2Kanji {
     /// (1)まず、計算済みnodeの確定分以降を取り出し、registeredにcompletedDataの値を反映したBOSにする。
     ///
     /// (2)次に、再度計算して良い候補を得る。
-    func kana2lattice_afterComplete(_ inputData: ComposingText, completedData: Candidate, N_best: Int, previousResult: (inputData: ComposingText, lattice: Lattice), needTypoCorrection _: Bool) -> (result: LatticeNode, lattice: Lattice) {
+    ///
+    /// `cancellation`によって中断された場合は途中までの結果を返す。
+    func kana2lattice_afterComplete(_ inputData: ComposingText, completedData: Candidate, N_best: Int, previousResult: (inputData: ComposingText, lattice: Lattice), needTypoCorrection _: Bool, cancellation: ConversionCancellation? = nil) -> (result: LatticeNode, lattice: Lattice) {
+        let measureStart = LatencyHistogram.now()
+        defer {
+            ConversionStatistics.latticeConstruction.record(since: measureStart)
+        }
         debug("確定直後の変換、前は：", previousResult.inputData, "後は：", inputData)
         let inputCount = inputData.input.count
         let surfaceCount = inputData.convertTarget.count
@@ -25,7 +31,7 @@ extension Kana2Kanji {
         let convertedSurfaceCount = previousResult.inputData.convertTarget.count - surfaceCount
         // (1)
         let start = RegisteredNode.fromLastCandidate(completedData)
-        let indexMap = LatticeDualIndexMap(inputData)
+        let indexMap = self.indexMapCache.indexMap(for: inputData)
         let latticeIndices = indexMap.indices(inputCount: inputCount, surfaceCount: surfaceCount)
         let lattice = previousResult.lattice.suffix(inputCount: inputCount, surfaceCount: surfaceCount)
         for (isHead, nodeArray) in lattice.indexedNodes(indices: latticeIndices) {
@@ -42,8 +48,13 @@ extension Kana2Kanji {
         }
         // (2)
         let result = LatticeNode.EOSNode
+        var successors = LatticeSuccessorBatches(lattice: lattice, dicdataStore: self.dicdataStore)
 
         for (isHead, nodeArray) in lattice.indexedNodes(indices: latticeIndices) {
+            // 中断された場合は途中までの結果を返す。結果は呼び出し側で破棄される
+            if cancellation?.isCancelled == true {
+                break
+            }
             for node in nodeArray {
                 if node.prevs.isEmpty {
                     continue
@@ -55,7 +66,7 @@ extension Kana2Kanji {
                 let wValue = node.data.value()
                 if isHead {
                     // valuesを更新する
-                    node.values = node.prevs.map {$0.totalValue + wValue + self.dicdataStore.getCCValue($0.data.rcid, node.data.lcid)}
+                    node.values = node.prevs.map {$0.totalValue + wValue + self.connectionCosts.value($0.data.rcid, node.data.lcid)}
                 } else {
                     // valuesを更新する
                     node.values = node.prevs.map {$0.totalValue + wValue}
@@ -65,7 +76,7 @@ extension Kana2Kanji {
                 if nextIndex.inputIndex == inputCount || nextIndex.surfaceIndex == surfaceCount {
                     self.updateResultNode(with: node, resultNode: result)
                 } else {
-                    self.updateNextNodes(with: node, nextNodes: lattice[index: nextIndex], nBest: N_best)
+                    self.updateNextNodes(with: node, successors: &successors, at: nextIndex, nBest: N_best)
                 }
             }
         }
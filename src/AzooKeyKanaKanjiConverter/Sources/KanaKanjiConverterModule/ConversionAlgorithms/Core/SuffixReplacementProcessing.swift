@@ -24,6 +24,8 @@ extension Kana2Kanji {
     /// (4)registerされた結果をresultノードに追加していく。
     ///
     /// (5)ノードをアップデートした上で返却する。
+    ///
+    /// `cancellation`によって中断された場合は途中までの結果を返す。
 
     func kana2lattice_changed(
         _ inputData: ComposingText,
@@ -31,8 +33,13 @@ extension Kana2Kanji {
         counts: (deletedInput: Int, addedInput: Int, deletedSurface: Int, addedSurface: Int),
         previousResult: (inputData: ComposingText, lattice: Lattice),
         needTypoCorrection: Bool,
-        dicdataStoreState: DicdataStoreState
+        dicdataStoreState: DicdataStoreState,
+        cancellation: ConversionCancellation? = nil
     ) -> (result: LatticeNode, lattice: Lattice) {
+        let measureStart = LatencyHistogram.now()
+        defer {
+            ConversionStatistics.latticeConstruction.record(since: measureStart)
+        }
         // (0)
         let inputCount = inputData.input.count
         let surfaceCount = inputData.convertTarget.count
@@ -41,7 +48,7 @@ extension Kana2Kanji {
         debug("kana2lattice_changed", inputData, counts, previousResult.inputData, inputCount, commonInputCount)
 
         // (1)
-        let indexMap = LatticeDualIndexMap(inputData)
+        let indexMap = self.indexMapCache.indexMap(for: inputData)
         let latticeIndices = indexMap.indices(inputCount: inputCount, surfaceCount: surfaceCount)
         var lattice = previousResult.lattice.prefix(inputCount: commonInputCount, surfaceCount: commonSurfaceCount)
 
@@ -81,7 +88,12 @@ extension Kana2Kanji {
                 rawNodes: rawNodes
             )
             // (3)
+            var addedSuccessors = LatticeSuccessorBatches(lattice: addedNodes, dicdataStore: self.dicdataStore)
             for nodeArray in lattice {
+                // 中断された場合は途中までの結果を返す。結果は呼び出し側で破棄される
+                if cancellation?.isCancelled == true {
+                    break
+                }
                 for node in nodeArray {
                     if node.prevs.isEmpty {
                         continue
@@ -92,7 +104,7 @@ extension Kana2Kanji {
                     // 変換した文字数
                     let nextIndex = indexMap.dualIndex(for: node.range.endIndex)
                     if nextIndex.surfaceIndex != surfaceCount {
-                        self.updateNextNodes(with: node, nextNodes: addedNodes[index: nextIndex], nBest: N_best)
+                        self.updateNextNodes(with: node, successors: &addedSuccessors, at: nextIndex, nBest: N_best)
                     }
                 }
             }
@@ -103,8 +115,13 @@ extension Kana2Kanji {
         // (3)
         // terminalNodesの各要素を結果ノードに接続する
         let result = LatticeNode.EOSNode
+        var terminalSuccessors = LatticeSuccessorBatches(lattice: terminalNodes, dicdataStore: self.dicdataStore)
 
         for (i, nodes) in terminalNodes.enumerated() {
+            // 中断された場合は途中までの結果を返す。結果は呼び出し側で破棄される
+            if cancellation?.isCancelled == true {
+                break
+            }
             for node in nodes {
                 if node.prevs.isEmpty {
                     continue
@@ -117,7 +134,7 @@ extension Kana2Kanji {
                 let wValue = node.data.value()
                 if i == 0 {
                     // valuesを更新する
-                    node.values = node.prevs.map {$0.totalValue + wValue + self.dicdataStore.getCCValue($0.data.rcid, node.data.lcid)}
+                    node.values = node.prevs.map {$0.totalValue + wValue + self.connectionCosts.value($0.data.rcid, node.data.lcid)}
                 } else {
                     // valuesを更新する
                     node.values = node.prevs.map {$0.totalValue + wValue}
@@ -126,7 +143,7 @@ extension Kana2Kanji {
                 if nextIndex.surfaceIndex == surfaceCount {
                     self.updateResultNode(with: node, resultNode: result)
                 } else {
-                    self.updateNextNodes(with: node, nextNodes: terminalNodes[index: nextIndex], nBest: N_best)
+                    self.updateNextNodes(with: node, successors: &terminalSuccessors, at: nextIndex, nBest: N_best)
                 }
             }
         }
@@ -25,6 +25,10 @@ extension Kana2Kanji {
     /// (2)次に、返却用ノードを計算する。
 
     func kana2lattice_no_change(N_best _: Int, previousResult: (inputData: ComposingText, lattice: Lattice)) -> (result: LatticeNode, lattice: Lattice) {
+        let measureStart = LatencyHistogram.now()
+        defer {
+            ConversionStatistics.latticeConstruction.record(since: measureStart)
+        }
         debug("キャッシュから復元、元の文字は：", previousResult.inputData.convertTarget)
         let inputCount = previousResult.inputData.input.count
         let surfaceCount = previousResult.inputData.convertTarget.count
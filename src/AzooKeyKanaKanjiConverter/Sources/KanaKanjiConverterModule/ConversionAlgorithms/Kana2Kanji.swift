@@ -15,7 +15,18 @@ public typealias PValue = Float32
 #endif
 
 struct Kana2Kanji {
-    var dicdataStore: DicdataStore
+    init(dicdataStore: DicdataStore) {
+        self.dicdataStore = dicdataStore
+        self.connectionCosts = dicdataStore.makeConnectionCostReader()
+    }
+
+    let dicdataStore: DicdataStore
+    /// 格子の計算で用いる連接確率。共有された`DicdataStore`のロックを取るのは行を初めて参照するときだけにする
+    let connectionCosts: DicdataStore.ConnectionCostReader
+    /// 格子の計算で作られる`RegisteredNode`を格納する領域。打鍵ごとに`reset()`して再利用する
+    let latticeArena = LatticeArena()
+    /// `ComposingText`のinputとsurfaceの位置の対応表。変換の経路によらず共有する
+    let indexMapCache = LatticeDualIndexMapCache()
 
     /// CandidateDataの状態からCandidateに変更する関数
     /// - parameters:
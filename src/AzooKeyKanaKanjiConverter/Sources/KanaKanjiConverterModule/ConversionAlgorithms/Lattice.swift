@@ -1,4 +1,5 @@
 import Algorithms
+import Foundation
 import SwiftUtils
 
 struct LatticeNodeArray: Sequence {
@@ -12,10 +13,80 @@ struct LatticeNodeArray: Sequence {
     }
 }
 
+/// ある位置から始まるノードを、遷移の計算に用いる値とともに連続した配列にまとめたもの
+///
+/// 同じ位置で終わるノードは全て同じ遷移先を持つため、遷移先の枝刈りや`lcid`の取り出しは位置ごとに一度だけ行う。
+struct LatticeSuccessorBatch {
+    init(nodes: some Sequence<LatticeNode>, dicdataStore: DicdataStore) {
+        self.nodes = nodes.filter { !dicdataStore.shouldBeRemoved(data: $0.data) }
+        self.lcids = self.nodes.map { Int32($0.data.lcid) }
+    }
+
+    /// `shouldBeRemoved`で除かれなかったノード
+    let nodes: [LatticeNode]
+    /// `nodes`の各要素の左文脈ID
+    let lcids: [Int32]
+}
+
+/// `Lattice`の位置ごとの`LatticeSuccessorBatch`を、参照された時点で作成して保持する
+struct LatticeSuccessorBatches {
+    init(lattice: Lattice, dicdataStore: DicdataStore) {
+        self.lattice = lattice
+        self.dicdataStore = dicdataStore
+    }
+
+    private let lattice: Lattice
+    private let dicdataStore: DicdataStore
+    private var batches: [LatticeDualIndexMap.DualIndex: LatticeSuccessorBatch] = [:]
+    /// 遷移のスコアを書き込む作業領域。呼び出しごとの確保を避けるために使い回す
+    var scores: [PValue] = []
+
+    mutating func batch(at index: LatticeDualIndexMap.DualIndex) -> LatticeSuccessorBatch {
+        if let batch = self.batches[index] {
+            return batch
+        }
+        let batch = LatticeSuccessorBatch(nodes: self.lattice[index: index], dicdataStore: self.dicdataStore)
+        self.batches[index] = batch
+        return batch
+    }
+}
+
 struct LatticeDualIndexMap: Sendable {
-    private var inputIndexToSurfaceIndexMap: [Int: Int]
+    /// inputの位置から、対応するsurfaceの位置への対応。対応する位置がない場合は-1
+    private var inputIndexToSurfaceIndex: [Int32]
+    /// surfaceの位置から、対応するinputの位置への対応。複数ある場合は最も前の位置を持ち、対応する位置がない場合は-1
+    private var surfaceIndexToInputIndex: [Int32]
+
     init(_ composingText: ComposingText) {
-        self.inputIndexToSurfaceIndexMap = composingText.inputIndexToSurfaceIndexMap()
+        var builder = ComposingText.IndependentSegmentBoundaryBuilder()
+        for element in composingText.input {
+            builder.append(element)
+        }
+        self.init(boundaries: builder.boundaries)
+    }
+
+    /// 独立セグメントの境界から、両方向の対応を配列として構築する
+    init(boundaries: [ComposingText.IndexPair]) {
+        let inputCount = (boundaries.map(\.inputIndex).max() ?? -1) + 1
+        let surfaceCount = (boundaries.map(\.surfaceIndex).max() ?? -1) + 1
+        self.inputIndexToSurfaceIndex = [Int32](repeating: -1, count: inputCount)
+        self.surfaceIndexToInputIndex = [Int32](repeating: -1, count: surfaceCount)
+        for pair in boundaries {
+            self.inputIndexToSurfaceIndex[pair.inputIndex] = Int32(pair.surfaceIndex)
+        }
+        // indices(inputCount:surfaceCount:)と同様に、同じsurfaceの位置に対応するinputの位置のうち最も前のものを用いる
+        for (iIndex, sIndex) in self.inputIndexToSurfaceIndex.enumerated().reversed() where sIndex >= 0 {
+            self.surfaceIndexToInputIndex[Int(sIndex)] = Int32(iIndex)
+        }
+    }
+
+    @inline(__always)
+    private static func lookup(_ map: [Int32], _ index: Int) -> Int? {
+        guard map.indices.contains(index) else {
+            return nil
+        }
+        let value = map[index]
+        return value < 0 ? nil : Int(value)
     }
 
     enum DualIndex: Sendable, Equatable, Hashable {
@@ -45,13 +116,13 @@ struct LatticeDualIndexMap: Sendable {
     func dualIndex(for latticeIndex: Lattice.LatticeIndex) -> DualIndex {
         switch latticeIndex {
         case .input(let iIndex):
-            if let sIndex = self.inputIndexToSurfaceIndexMap[iIndex] {
+            if let sIndex = Self.lookup(self.inputIndexToSurfaceIndex, iIndex) {
                 .bothIndex(inputIndex: iIndex, surfaceIndex: sIndex)
             } else {
                 .inputIndex(iIndex)
             }
         case .surface(let sIndex):
-            if let iIndex = self.inputIndexToSurfaceIndexMap.filter({ $0.value == sIndex}).first?.key {
+            if let iIndex = Self.lookup(self.surfaceIndexToInputIndex, sIndex) {
                 .bothIndex(inputIndex: iIndex, surfaceIndex: sIndex)
             } else {
                 .surfaceIndex(sIndex)
@@ -63,7 +134,7 @@ struct LatticeDualIndexMap: Sendable {
         var indices: [DualIndex] = []
         var sIndexPointer = 0
         for i in 0 ..< inputCount {
-            if let sIndex = self.inputIndexToSurfaceIndexMap[i] {
+            if let sIndex = Self.lookup(self.inputIndexToSurfaceIndex, i) {
                 for j in min(sIndexPointer, sIndex) ..< sIndex {
                     indices.append(.surfaceIndex(j))
                 }
@@ -84,6 +155,36 @@ struct LatticeDualIndexMap: Sendable {
     }
 }
 
+/// 直前に変換した`ComposingText`に対する`LatticeDualIndexMap`を保持する
+///
+/// `kana2lattice_*`のどの経路でも同じ対応表を使い回す。打鍵ごとの変換では入力の末尾に要素が追加されることが多いため、
+/// 前回の`input`が今回の`input`の先頭と一致する場合は、追加された要素の分だけ独立セグメントの境界を求めて更新する。
+final class LatticeDualIndexMapCache: @unchecked Sendable {
+    private let lock = NSLock()
+    private var input: [ComposingText.InputElement] = []
+    private var builder = ComposingText.IndependentSegmentBoundaryBuilder()
+    private var indexMap: LatticeDualIndexMap?
+
+    func indexMap(for composingText: ComposingText) -> LatticeDualIndexMap {
+        self.lock.withLock {
+            if let indexMap, self.input == composingText.input {
+                return indexMap
+            }
+            if !composingText.input.starts(with: self.input) {
+                self.input = []
+                self.builder = ComposingText.IndependentSegmentBoundaryBuilder()
+            }
+            for element in composingText.input[self.input.endIndex...] {
+                self.builder.append(element)
+            }
+            self.input = composingText.input
+            let indexMap = LatticeDualIndexMap(boundaries: self.builder.boundaries)
+            self.indexMap = indexMap
+            return indexMap
+        }
+    }
+}
+
 struct Lattice: Sequence {
     typealias Element = LatticeNodeArray
 
@@ -164,7 +265,7 @@ struct Lattice: Sequence {
         // 探索で変化した状態をすべて削除する
         self.inputIndexedNodes.forEach { nodes in
             nodes.forEach {
-                $0.prevs.removeAll()
+                $0.removeAllPrevs()
                 $0.values.removeAll()
                 if $0.range.startIndex.isZero {
                     $0.prevs.append(.BOSNode())
@@ -173,7 +274,7 @@ struct Lattice: Sequence {
         }
         self.surfaceIndexedNodes.forEach { nodes in
             nodes.forEach {
-                $0.prevs.removeAll()
+                $0.removeAllPrevs()
                 $0.values.removeAll()
                 if $0.range.startIndex.isZero {
                     $0.prevs.append(.BOSNode())
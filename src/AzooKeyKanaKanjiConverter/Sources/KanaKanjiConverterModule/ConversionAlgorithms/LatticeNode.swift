@@ -13,7 +13,23 @@ public final class LatticeNode {
     /// このノードが保持する辞書データ
     public let data: DicdataElement
     /// このノードの前に来ているノード。`N_best`の分だけ保存する
-    var prevs: [RegisteredNode] = []
+    ///
+    /// `Kana2Kanji.updateNextNodes`で選ばれた経路は`pendingPaths`に保持しておき、参照された時点で`RegisteredNode`を作成する。
+    var prevs: [RegisteredNode] {
+        get {
+            self.materializePendingPaths()
+            return self._prevs
+        }
+        _modify {
+            self.materializePendingPaths()
+            yield &self._prevs
+        }
+    }
+    private var _prevs: [RegisteredNode] = []
+    /// `RegisteredNode`をまだ作成していない、このノードに至る経路
+    private var pendingPaths = NBestBuffer<PendingPath>(capacity: 0)
+    /// `pendingPaths`から`RegisteredNode`を作成する際に用いる領域
+    private var pendingArena: LatticeArena?
     /// `prevs`の各要素に対応するスコアのデータ
     var values: [PValue] = []
     /// inputData.input内のrange
@@ -32,8 +48,64 @@ public final class LatticeNode {
 
     /// `LatticeNode`の持っている情報を反映した`RegisteredNode`を作成する
     /// `LatticeNode`は複数の過去のノードを持つことができるが、`RegisteredNode`は1つしか持たない。
-    func getRegisteredNode(_ index: Int, value: PValue) -> RegisteredNode {
-        RegisteredNode(data: self.data, registered: self.prevs[index], totalValue: value, range: self.range)
+    func getRegisteredNode(_ index: Int, value: PValue, arena: LatticeArena) -> RegisteredNode {
+        arena.makeNode(data: self.data, registered: self.prevs[index], totalValue: value, range: self.range)
+    }
+
+    /// `source`の`index`番目の経路を経由してこのノードに至る経路を、上位`nBest`件に入る場合に限り追加する
+    ///
+    /// `RegisteredNode`は作成せず、`prevs`が参照されるまで遅延する。途中で上位から外れた経路にはノードを作成しない。
+    func addPendingPath(from source: LatticeNode, index: Int, value: PValue, nBest: Int, arena: LatticeArena) {
+        if self.pendingPaths.isEmpty {
+            if self.pendingPaths.capacity != nBest {
+                self.pendingPaths = NBestBuffer(capacity: nBest)
+            }
+            self.pendingArena = arena
+        }
+        self.pendingPaths.insert(PendingPath(source: source, prev: source._prevs[index], range: source.range), value: value)
+    }
+
+    /// `addPendingPath`で上位`nBest`件に入るために上回る必要のあるスコア。まだ上限に達していない場合は`nil`
+    func pendingPathThreshold(nBest: Int) -> PValue? {
+        if self.pendingPaths.isEmpty {
+            return nBest > 0 ? nil : .infinity
+        }
+        return self.pendingPaths.threshold
+    }
+
+    /// 未作成の経路も含め、`prevs`を全て取り除く
+    func removeAllPrevs() {
+        self._prevs.removeAll()
+        self.pendingPaths.removeAll()
+        self.pendingArena = nil
+    }
+
+    /// `pendingPaths`の経路から`RegisteredNode`を作成し、`_prevs`に統合する
+    private func materializePendingPaths() {
+        guard !self.pendingPaths.isEmpty, let arena = self.pendingArena else {
+            return
+        }
+        let existing = self._prevs
+        let values = self.pendingPaths.values
+        let paths = self.pendingPaths.elements
+        let capacity = max(self.pendingPaths.capacity, existing.count)
+        var merged: [RegisteredNode] = []
+        merged.reserveCapacity(min(capacity, existing.count + paths.count))
+        var (i, j) = (existing.startIndex, paths.startIndex)
+        while merged.count < capacity && (i < existing.endIndex || j < paths.endIndex) {
+            // スコアが等しい場合は先に追加されていた経路を優先する
+            if j == paths.endIndex || (i < existing.endIndex && existing[i].totalValue >= values[j]) {
+                merged.append(existing[i])
+                i += 1
+            } else {
+                let path = paths[j]
+                merged.append(arena.makeNode(data: path.source.data, registered: path.prev, totalValue: values[j], range: path.range))
+                j += 1
+            }
+        }
+        self._prevs = merged
+        self.pendingPaths.removeAll()
+        self.pendingArena = nil
     }
 
     /// 再帰的にノードを遡り、`CandidateData`を構築する関数
@@ -43,3 +115,13 @@ public final class LatticeNode {
         self.prevs.map {$0.getCandidateData()}
     }
 }
+
+/// `RegisteredNode`を作成する前の経路。`LatticeNode.addPendingPath`で作られる
+private struct PendingPath {
+    /// 経路上でこのノードの1つ前にあるノード
+    var source: LatticeNode
+    /// `source`に至る経路
+    var prev: RegisteredNode
+    /// 追加した時点での`source.range`
+    var range: Lattice.LatticeRange
+}
@@ -0,0 +1,66 @@
+/// スコアの大きい順に上位`capacity`件の要素だけを保持するバッファ
+///
+/// 格子の計算では、1つのノードに対して辺の数×`N_best`回の挿入が行われる。
+/// 容量は作成時に確保し、挿入位置は末尾から比較して求めるため、挿入ごとの再確保や優先度付きキューの操作が発生しない。
+/// スコアが等しい場合は先に挿入された要素を前に置く。
+struct NBestBuffer<Element> {
+    init(capacity: Int) {
+        self.capacity = max(capacity, 0)
+        self.values.reserveCapacity(self.capacity)
+        self.elements.reserveCapacity(self.capacity)
+    }
+
+    /// 保持する要素数の上限
+    let capacity: Int
+    /// 各要素のスコア。大きい順に並ぶ
+    private(set) var values: [PValue] = []
+    /// `values`と同じ順に並んだ要素
+    private(set) var elements: [Element] = []
+
+    var count: Int {
+        self.values.count
+    }
+
+    var isEmpty: Bool {
+        self.values.isEmpty
+    }
+
+    /// 新たに挿入される要素が上回る必要のあるスコア。空きがある場合は`nil`
+    var threshold: PValue? {
+        self.values.count < self.capacity ? nil : self.values.last ?? .infinity
+    }
+
+    /// `value`を挿入する位置を返す。上位`capacity`件に入らない場合は`capacity`を返す
+    @inline(__always)
+    func insertionIndex(of value: PValue) -> Int {
+        var index = self.values.endIndex
+        // 多くの候補は末尾との比較1回で棄却される
+        while index > 0 && self.values[index - 1] < value {
+            index -= 1
+        }
+        return index
+    }
+
+    /// 要素を挿入する。上位`capacity`件に入らない場合は`element`を評価せずに`false`を返す
+    @discardableResult
+    mutating func insert(_ element: @autoclosure () -> Element, value: PValue) -> Bool {
+        let index = self.insertionIndex(of: value)
+        guard index < self.capacity else {
+            return false
+        }
+        // 溢れる要素を先に取り除いてから挿入する（insertはO(N)なので）
+        if self.values.count == self.capacity {
+            self.values.removeLast()
+            self.elements.removeLast()
+        }
+        self.values.insert(value, at: index)
+        self.elements.insert(element(), at: index)
+        return true
+    }
+
+    /// 容量を残したまま全ての要素を取り除く
+    mutating func removeAll() {
+        self.values.removeAll(keepingCapacity: true)
+        self.elements.removeAll(keepingCapacity: true)
+    }
+}
@@ -1,53 +1,56 @@
 import Foundation
 
-/// `indirect enum`を用いて再帰的なノード構造を実現
-indirect enum RegisteredNode {
-    case node(data: DicdataElement, prev: RegisteredNode?, totalValue: PValue, range: Lattice.LatticeRange)
+/// ラティス上の経路を1つ前のノードへの参照で表したノード
+///
+/// 実体は`LatticeArena`の列にまとめて格納され、この構造体はその位置を指すだけである。
+/// ノードごとにヒープ領域を確保しないため、N-bestの候補を大量に作る格子の計算でも確保の回数が増えない。
+struct RegisteredNode: Sendable {
+    fileprivate init(storage: LatticeArena.Storage, index: Int32) {
+        self.storage = storage
+        self.index = index
+    }
+
+    /// ノードの実体を格納している領域
+    fileprivate let storage: LatticeArena.Storage
+    /// `storage`内での位置
+    fileprivate let index: Int32
 
     /// このノードが保持する辞書データ
     var data: DicdataElement {
         _read {
-            switch self {
-            case .node(let data, _, _, _):
-                yield data
-            }
+            yield self.storage.data[Int(self.index)]
         }
     }
 
     /// 1つ前のノードのデータ
     var prev: RegisteredNode? {
-        _read {
-            switch self {
-            case .node(_, let prev, _, _):
-                yield prev
-            }
-        }
+        self.storage.prev(of: Int(self.index))
     }
 
     /// 始点からこのノードまでのコスト
     var totalValue: PValue {
-        switch self {
-        case .node(_, _, let totalValue, _):
-            return totalValue
-        }
+        self.storage.totalValues[Int(self.index)]
     }
 
     /// `composingText`の`input`で対応する範囲
     var range: Lattice.LatticeRange {
-        switch self {
-        case .node(_, _, _, let range):
-            return range
-        }
+        self.storage.ranges[Int(self.index)]
     }
 
+    /// `LatticeArena`を介さずに単独のノードを作成する
+    /// - note: 格子の計算では`LatticeArena.makeNode`を用いる。
     init(data: DicdataElement, registered: RegisteredNode?, totalValue: PValue, range: Lattice.LatticeRange) {
-        self = .node(data: data, prev: registered, totalValue: totalValue, range: range)
+        let storage = LatticeArena.Storage()
+        self = storage.append(data: data, prev: registered, totalValue: totalValue, range: range)
     }
 
+    /// 全ての格子で共有する始点ノード
+    private static let bos = RegisteredNode(data: DicdataElement.BOSData, registered: nil, totalValue: 0, range: .zero)
+
     /// 始点ノードを生成する関数
     /// - Returns: 始点ノードのデータ
     static func BOSNode() -> RegisteredNode {
-        RegisteredNode(data: DicdataElement.BOSData, registered: nil, totalValue: 0, range: .zero)
+        Self.bos
     }
 
     /// 入力中、確定した部分を考慮した始点ノードを生成する関数
@@ -62,6 +65,107 @@ indirect enum RegisteredNode {
     }
 }
 
+/// 1回の変換で作られる`RegisteredNode`をまとめて格納する領域
+///
+/// ノードの各値を列ごとの配列に並べ、1つ前のノードは位置で参照する。
+/// 差分更新では前回のラティスのノードを引き続き参照するため、入力中は同じ領域にノードを追加し続ける。
+/// `reset()`は前回のラティスを手放した後（入力の終了時や新規に計算し直す時）に呼ぶ。
+/// このとき前回の変換のノードがどこからも参照されていなければ、配列の容量を残したまま中身だけを消して再利用する。
+final class LatticeArena: @unchecked Sendable {
+    /// ノードの実体。`RegisteredNode`から参照される
+    final class Storage: @unchecked Sendable {
+        fileprivate var data: [DicdataElement] = []
+        /// 1つ前のノードの位置。存在しない場合は-1
+        private var prevIndices: [Int32] = []
+        /// 1つ前のノードが別の領域にある場合のその領域。同じ領域の場合は循環参照を避けるため`nil`とする
+        private var prevStorages: [Storage?] = []
+        fileprivate var totalValues: [PValue] = []
+        fileprivate var ranges: [Lattice.LatticeRange] = []
+
+        var count: Int {
+            self.totalValues.count
+        }
+
+        var capacity: Int {
+            self.totalValues.capacity
+        }
+
+        fileprivate func prev(of index: Int) -> RegisteredNode? {
+            let prevIndex = self.prevIndices[index]
+            guard prevIndex >= 0 else {
+                return nil
+            }
+            return RegisteredNode(storage: self.prevStorages[index] ?? self, index: prevIndex)
+        }
+
+        fileprivate func append(data: DicdataElement, prev: RegisteredNode?, totalValue: PValue, range: Lattice.LatticeRange) -> RegisteredNode {
+            let index = Int32(self.totalValues.count)
+            self.data.append(data)
+            self.prevIndices.append(prev?.index ?? -1)
+            self.prevStorages.append(prev.flatMap { $0.storage === self ? nil : $0.storage })
+            self.totalValues.append(totalValue)
+            self.ranges.append(range)
+            return RegisteredNode(storage: self, index: index)
+        }
+
+        fileprivate func reserveCapacity(_ capacity: Int) {
+            self.data.reserveCapacity(capacity)
+            self.prevIndices.reserveCapacity(capacity)
+            self.prevStorages.reserveCapacity(capacity)
+            self.totalValues.reserveCapacity(capacity)
+            self.ranges.reserveCapacity(capacity)
+        }
+
+        fileprivate func removeAll() {
+            self.data.removeAll(keepingCapacity: true)
+            self.prevIndices.removeAll(keepingCapacity: true)
+            self.prevStorages.removeAll(keepingCapacity: true)
+            self.totalValues.removeAll(keepingCapacity: true)
+            self.ranges.removeAll(keepingCapacity: true)
+        }
+    }
+
+    /// 入力中に蓄積してよいノード数の上限
+    ///
+    /// 差分更新で使われなくなったノードも`reset()`までは解放されないため、これを超えた場合は前回のラティスを手放して新規に計算する。
+    static let retentionLimit = 1 << 15
+
+    private var storage = Storage()
+
+    /// 現在の領域に格納されているノードの数
+    var count: Int {
+        self.storage.count
+    }
+
+    /// 現在の領域が再確保なしに格納できるノードの数
+    var capacity: Int {
+        self.storage.capacity
+    }
+
+    /// 現在の領域を識別する値。領域が再利用されたかの確認に用いる
+    var storageIdentifier: ObjectIdentifier {
+        ObjectIdentifier(self.storage)
+    }
+
+    /// ノードを作成して現在の領域に追加する
+    func makeNode(data: DicdataElement, registered: RegisteredNode?, totalValue: PValue, range: Lattice.LatticeRange) -> RegisteredNode {
+        self.storage.append(data: data, prev: registered, totalValue: totalValue, range: range)
+    }
+
+    /// 次の変換のために領域を空にする
+    ///
+    /// 作成済みの`RegisteredNode`が残っている場合は新しい領域に切り替えるため、それらは引き続き有効である。
+    func reset() {
+        if isKnownUniquelyReferenced(&self.storage) {
+            self.storage.removeAll()
+        } else {
+            let capacity = self.storage.count
+            self.storage = Storage()
+            self.storage.reserveCapacity(capacity)
+        }
+    }
+}
+
 extension RegisteredNode {
     /// 再帰的にノードを遡り、`CandidateData`を構築する関数
     /// - Returns: 文節単位の区切り情報を持った変換候補データ
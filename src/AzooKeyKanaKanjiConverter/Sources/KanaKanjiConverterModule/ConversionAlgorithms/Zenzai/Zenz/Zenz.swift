@@ -35,11 +35,16 @@ package final class Zenz {
         requestRichCandidates: Bool,
         prefixConstraint: Kana2Kanji.PrefixConstraint,
         personalizationMode: (mode: ConvertRequestOptions.ZenzaiMode.PersonalizationMode, base: EfficientNGram, personal: EfficientNGram)?,
-        versionDependentConfig: ConvertRequestOptions.ZenzaiVersionDependentMode
+        versionDependentConfig: ConvertRequestOptions.ZenzaiVersionDependentMode,
+        cancellation: ConversionCancellation? = nil
     ) -> ZenzContext.CandidateEvaluationResult {
         guard let zenzContext else {
             return .error
         }
+        zenzContext.setCancellation(cancellation)
+        defer {
+            zenzContext.setCancellation(nil)
+        }
         for candidate in candidates {
             return zenzContext.evaluate_candidate(
                 input: convertTarget.toKatakana(),
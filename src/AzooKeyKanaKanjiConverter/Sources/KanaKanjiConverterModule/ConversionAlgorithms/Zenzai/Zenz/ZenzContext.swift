@@ -137,6 +137,21 @@ final class ZenzContext {
         return ZenzContext(model: model, context: context, vocab: vocab)
     }
 
+    /// `llama_decode`の計算中に`cancellation`を確認させる。`nil`を渡すと解除する。
+    /// - note: 中断された`llama_decode`は失敗を返すため、評価結果は`.error`になる。
+    func setCancellation(_ cancellation: ConversionCancellation?) {
+        guard let cancellation else {
+            llama_set_abort_callback(self.context, nil, nil)
+            return
+        }
+        llama_set_abort_callback(self.context, { data in
+            guard let data else {
+                return false
+            }
+            return Unmanaged<ConversionCancellation>.fromOpaque(data).takeUnretainedValue().isCancelled
+        }, Unmanaged.passUnretained(cancellation).toOpaque())
+    }
+
     func reset_context() throws {
         llama_free(self.context)
         var params = Self.ctx_params
@@ -154,6 +169,10 @@ final class ZenzContext {
     }
 
     private func get_logits(tokens: [llama_token], logits_start_index: Int = 0) -> UnsafeMutablePointer<Float>? {
+        let start = LatencyHistogram.now()
+        defer {
+            ConversionStatistics.zenzaiDecode.record(since: start)
+        }
         // Manage KV cache: remove entries that differ from previous input
         let prefixCacheCount: Int
         do {
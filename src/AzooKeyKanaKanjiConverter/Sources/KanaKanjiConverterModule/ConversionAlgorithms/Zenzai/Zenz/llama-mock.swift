@@ -62,4 +62,7 @@ package func llama_token_to_piece(_: llama_vocab, _: llama_token, _: UnsafeMutab
 
 package func llama_decode(_: llama_context, _: llama_batch) -> Int { unimplemented() }
 package func llama_get_logits(_: llama_context) -> UnsafeMutablePointer<Float>? { unimplemented() }
+
+package typealias ggml_abort_callback = @convention(c) (UnsafeMutableRawPointer?) -> Bool
+package func llama_set_abort_callback(_: llama_context, _: ggml_abort_callback?, _: UnsafeMutableRawPointer?) {}
 #endif
@@ -0,0 +1,23 @@
+public import Foundation
+
+/// 実行中の変換を中断するためのフラグ
+///
+/// 変換を呼び出したスレッドとは別のスレッドから`cancel()`を呼ぶことを想定している。
+/// 中断はラティス構築の各段階、zenzaiの推論ループおよび`llama_decode`の計算中に確認される。
+/// 中断された変換の途中結果は保持されず、次回の変換は新規に計算される。
+public final class ConversionCancellation: @unchecked Sendable {
+    private let lock = NSLock()
+    private var _isCancelled = false
+
+    public init() {}
+
+    /// 中断が要求されたかどうか
+    public var isCancelled: Bool {
+        lock.withLock { _isCancelled }
+    }
+
+    /// 変換の中断を要求する
+    public func cancel() {
+        lock.withLock { _isCancelled = true }
+    }
+}
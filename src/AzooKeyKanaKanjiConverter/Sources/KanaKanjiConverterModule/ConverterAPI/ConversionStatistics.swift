@@ -0,0 +1,140 @@
+import Dispatch
+import Foundation
+
+/// 処理時間の分布を記録するスレッドセーフなヒストグラム
+///
+/// 1ns〜約18分の範囲を、2倍ごとに4分割した対数スケールのバケットで保持する。
+/// パーセンタイルはバケットの上限値で近似するため、誤差は最大で約19%となる。
+public final class LatencyHistogram: @unchecked Sendable {
+    /// 2倍あたりのバケット数
+    private static let subBucketCount = 4
+    private static let bucketCount = 40 * subBucketCount
+
+    private let lock = NSLock()
+    private var buckets: [UInt64] = .init(repeating: 0, count: LatencyHistogram.bucketCount)
+    private var count: UInt64 = 0
+    private var totalNanoseconds: UInt64 = 0
+    private var maxNanoseconds: UInt64 = 0
+
+    public init() {}
+
+    /// 計測結果
+    public struct Snapshot: Sendable, Equatable {
+        /// 記録された回数
+        public var count: UInt64
+        /// 合計時間
+        public var totalNanoseconds: UInt64
+        /// 中央値
+        public var p50Nanoseconds: UInt64
+        /// 99パーセンタイル
+        public var p99Nanoseconds: UInt64
+        /// 最大値
+        public var maxNanoseconds: UInt64
+    }
+
+    /// 単調増加する現在時刻(ns)
+    public static func now() -> UInt64 {
+        DispatchTime.now().uptimeNanoseconds
+    }
+
+    private static func bucketIndex(_ nanoseconds: UInt64) -> Int {
+        guard nanoseconds > 1 else {
+            return 0
+        }
+        // 上位ビットの位置と、その次の2ビットからバケットを決める
+        let log2 = 63 - nanoseconds.leadingZeroBitCount
+        let fraction = log2 >= 2 ? Int((nanoseconds >> UInt64(log2 - 2)) & 0b11) : Int((nanoseconds << UInt64(2 - log2)) & 0b11)
+        return min(log2 * subBucketCount + fraction, bucketCount - 1)
+    }
+
+    private static func bucketUpperBound(_ index: Int) -> UInt64 {
+        let log2 = index / subBucketCount
+        let fraction = UInt64(index % subBucketCount + 1)
+        return log2 >= 2 ? ((4 + fraction) << UInt64(log2 - 2)) - 1 : UInt64(1) << UInt64(log2 + 1)
+    }
+
+    /// 1回分の処理時間を記録する
+    public func record(nanoseconds: UInt64) {
+        let index = Self.bucketIndex(nanoseconds)
+        lock.withLock {
+            buckets[index] += 1
+            count += 1
+            totalNanoseconds &+= nanoseconds
+            maxNanoseconds = max(maxNanoseconds, nanoseconds)
+        }
+    }
+
+    /// `LatencyHistogram.now()`で得た時刻`start`から現在までの時間を記録する
+    public func record(since start: UInt64) {
+        let now = Self.now()
+        self.record(nanoseconds: now >= start ? now - start : 0)
+    }
+
+    /// `body`の実行時間を記録する
+    public func measure<R>(_ body: () throws -> R) rethrows -> R {
+        let start = Self.now()
+        defer {
+            self.record(since: start)
+        }
+        return try body()
+    }
+
+    public func snapshot() -> Snapshot {
+        lock.withLock {
+            Snapshot(
+                count: count,
+                totalNanoseconds: totalNanoseconds,
+                p50Nanoseconds: percentile(0.5),
+                p99Nanoseconds: percentile(0.99),
+                maxNanoseconds: maxNanoseconds
+            )
+        }
+    }
+
+    /// lockを取った状態で呼ぶこと
+    private func percentile(_ p: Double) -> UInt64 {
+        guard count > 0 else {
+            return 0
+        }
+        let target = UInt64((Double(count) * p).rounded(.up))
+        var accumulated: UInt64 = 0
+        for (index, bucket) in buckets.enumerated() {
+            accumulated += bucket
+            if accumulated >= target {
+                return min(Self.bucketUpperBound(index), maxNanoseconds)
+            }
+        }
+        return maxNanoseconds
+    }
+
+    public func reset() {
+        lock.withLock {
+            buckets = .init(repeating: 0, count: Self.bucketCount)
+            count = 0
+            totalNanoseconds = 0
+            maxNanoseconds = 0
+        }
+    }
+}
+
+/// 変換の各段階にかかった時間の統計
+///
+/// プロセス全体で共有される。本番環境での性能の劣化を、プロファイラなしで検出するために利用する。
+public enum ConversionStatistics {
+    /// `KanaKanjiConverter.requestCandidates`全体
+    public static let requestCandidates = LatencyHistogram()
+    /// `DicdataStore.lookupDicdata`
+    public static let lookupDicdata = LatencyHistogram()
+    /// `Kana2Kanji.kana2lattice_*`によるラティスの構築(辞書引きを含む)
+    public static let latticeConstruction = LatencyHistogram()
+    /// `ZenzContext.get_logits`(zenzaiの推論)
+    public static let zenzaiDecode = LatencyHistogram()
+
+    /// 全ての統計を0に戻す
+    public static func reset() {
+        requestCandidates.reset()
+        lookupDicdata.reset()
+        latticeConstruction.reset()
+        zenzaiDecode.reset()
+    }
+}
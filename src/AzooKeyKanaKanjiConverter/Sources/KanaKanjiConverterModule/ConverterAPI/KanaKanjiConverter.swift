@@ -42,6 +42,8 @@ public final class KanaKanjiConverter {
     private var previousInputData: ComposingText?
     private var lattice: Lattice = Lattice()
     private var completedData: Candidate?
+    /// 直前の`requestCandidates`で単語候補などの生成を省略したかどうか。候補を早期に返した場合は省略したものがないため`false`
+    private var hasDeferredWordCandidates = false
     private var lastData: DicdataElement?
     /// Zenzaiのためのzenzモデル
     private var zenz: Zenz?
@@ -58,7 +60,15 @@ public final class KanaKanjiConverter {
         self.previousInputData = nil
         self.lattice = .init()
         self.completedData = nil
+        self.hasDeferredWordCandidates = false
         self.lastData = nil
+        // 前回のラティスを手放したので、ノードの領域を容量を残したまま空にする
+        self.converter.latticeArena.reset()
+    }
+
+    /// ノードの領域。テストで領域の再利用を確認するために用いる
+    var latticeArena: LatticeArena {
+        self.converter.latticeArena
     }
 
     private func getZenzaiPersonalization(mode: ConvertRequestOptions.ZenzaiMode.PersonalizationMode?) -> (mode: ConvertRequestOptions.ZenzaiMode.PersonalizationMode, base: EfficientNGram, personal: EfficientNGram)? {
@@ -103,6 +113,18 @@ public final class KanaKanjiConverter {
         return zenz.predictNextCharacter(leftSideContext: leftSideContext, count: count)
     }
 
+    /// zenzaiのモデルを読み込み、ダミーの推論を1回行う関数。
+    /// 起動直後などにこの関数を呼んでおくことで、初回の変換でモデルの読み込みを待たずに済む。
+    /// - Returns: モデルを読み込めた場合`true`
+    @discardableResult
+    public func warmUpZenzai(weightURL: URL) -> Bool {
+        guard let zenz = self.getModel(modelURL: weightURL) else {
+            return false
+        }
+        _ = zenz.predictNextCharacter(leftSideContext: "。", count: 1)
+        return true
+    }
+
     /// 入力する言語が分かったらこの関数をなるべく早い段階で呼ぶことで、SpellCheckerの初期化が行われ、変換がスムーズになる
     public func setKeyboardLanguage(_ language: KeyboardLanguage) {
         self.dicdataStoreState.updateKeyboardLanguage(language)
@@ -128,6 +150,22 @@ public final class KanaKanjiConverter {
         self.dicdataStoreState.updateUserDictionaryURL(newURL)
     }
 
+    /// ユーザ辞書のエントリを追加・削除する。変更は次の変換から反映される
+    /// - Parameters:
+    ///   - adding: 追加するエントリ。
+    ///   - removing: 削除するエントリ。読みと表層形が一致するエントリが全て削除される。
+    /// - Note: 変更はまず差分として保持されます。`compileUserDictionaryInBackground`を呼ぶとユーザ辞書のファイルに統合されます。
+    public func updateUserDictionary(adding: [DicdataElement] = [], removing: [DicdataElement] = []) {
+        let changes = removing.map { UserDictionaryCompiler.Change.remove(ruby: $0.ruby, word: $0.word) } + adding.map { .add($0) }
+        self.converter.dicdataStore.applyUserDictionaryChanges(changes, state: self.dicdataStoreState)
+    }
+
+    /// `updateUserDictionary`で加えた変更をバックグラウンドでユーザ辞書のファイルに統合する
+    /// - Parameter completion: 統合が終わったときに呼ばれる。統合した場合は`true`
+    public func compileUserDictionaryInBackground(completion: (@Sendable (Bool) -> Void)? = nil) {
+        self.converter.dicdataStore.compileUserDictionaryInBackground(state: self.dicdataStoreState, completion: completion)
+    }
+
     public func updateLearningConfig(_ newConfig: LearningConfig) {
         self.dicdataStoreState.updateLearningConfig(newConfig)
     }
@@ -477,13 +515,15 @@ public final class KanaKanjiConverter {
     ///   - inputData: 変換対象のInputData。
     ///   - result: convertToLatticeによって得られた結果。
     ///   - options: リクエストにかかるオプション。
+    ///   - deferWordCandidates: `true`の場合、単語候補・付加的な候補・特殊な候補の生成を省略する。省略した候補は`requestDeferredCandidates`で得られる。
     /// - Returns:
     ///   重複のない変換候補。
     /// - Note:
     ///   現在の実装は非常に複雑な方法で候補の順序を決定している。
-    private func processResult(inputData: ComposingText, result: (result: LatticeNode, lattice: Lattice), options: ConvertRequestOptions) -> ConversionResult {
+    private func processResult(inputData: ComposingText, result: (result: LatticeNode, lattice: Lattice), options: ConvertRequestOptions, deferWordCandidates: Bool = false) -> ConversionResult {
         self.previousInputData = inputData
         self.lattice = result.lattice
+        self.hasDeferredWordCandidates = false
         // 比較的大きい配列（〜1000、2000程度の候補が含まれることがある）
         let clauseResult = result.result.getCandidateData()
         if clauseResult.isEmpty {
@@ -612,35 +652,12 @@ public final class KanaKanjiConverter {
             seenCandidate.insert(c.text)
         }
         // 文字列の長さごとに並べ、かつその中で評価の高いものから順に並べる。
-        let wordCandidates: [Candidate]
-        do {
-            // 最初の辞書データ
-            let dicCandidates: [Candidate] = result.lattice[index: .bothIndex(inputIndex: 0, surfaceIndex: 0)]
-                .map {
-                    Candidate(
-                        text: $0.data.word,
-                        value: $0.data.value(),
-                        composingCount: $0.range.count,
-                        lastMid: $0.data.mid,
-                        data: [$0.data]
-                    )
-                }
-            // その他辞書データに追加する候補
-            let additionalCandidates: [Candidate] = self.getAdditionalCandidate(inputData, options: options)
-            var candidates = self.getUniqueCandidate((consume dicCandidates).chained(consume additionalCandidates), seenCandidates: seenCandidate)
-                .sorted {
-                    let count0 = $0.rubyCount
-                    let count1 = $1.rubyCount
-                    return count0 == count1 ? $0.value > $1.value : count0 > count1
-                }
-            for c in candidates {
-                seenCandidate.insert(c.text)
-            }
-            // 賢く変換するパターン（任意件数）
-            let wiseCandidates = self.getUniqueCandidate(self.getSpecialCandidate(inputData, options: options), seenCandidates: seenCandidate)
-            // 途中でwise_candidatesを挟む
-            candidates.insert(contentsOf: consume wiseCandidates, at: min(5, candidates.endIndex))
-            wordCandidates = consume candidates
+        // 省略した場合は`requestDeferredCandidates`で生成する
+        self.hasDeferredWordCandidates = deferWordCandidates
+        let wordCandidates: [Candidate] = if deferWordCandidates {
+            []
+        } else {
+            self.getWordCandidates(inputData, lattice: result.lattice, options: options, seenCandidates: &seenCandidate)
         }
 
         var result = consume fullCandidates
@@ -672,16 +689,85 @@ public final class KanaKanjiConverter {
         return ConversionResult(mainResults: result, firstClauseResults: firstClauseResults)
     }
 
+    /// 先頭から始まる辞書データ、付加的な候補、特殊な候補からなる単語候補を生成する関数
+    /// - Parameters:
+    ///   - inputData: 変換対象のInputData。
+    ///   - lattice: `inputData`に対して構築されたラティス。
+    ///   - options: リクエストにかかるオプション。
+    ///   - seenCandidates: 既出の候補のテキスト。生成した候補のテキストが追加される。
+    /// - Returns:
+    ///   文字列の長さごとに並べ、かつその中で評価の高いものから順に並べた候補。
+    private func getWordCandidates(_ inputData: ComposingText, lattice: Lattice, options: ConvertRequestOptions, seenCandidates: inout Set<String>) -> [Candidate] {
+        // 最初の辞書データ
+        let dicCandidates: [Candidate] = lattice[index: .bothIndex(inputIndex: 0, surfaceIndex: 0)]
+            .map {
+                Candidate(
+                    text: $0.data.word,
+                    value: $0.data.value(),
+                    composingCount: $0.range.count,
+                    lastMid: $0.data.mid,
+                    data: [$0.data]
+                )
+            }
+        // その他辞書データに追加する候補
+        let additionalCandidates: [Candidate] = self.getAdditionalCandidate(inputData, options: options)
+        var candidates = self.getUniqueCandidate((consume dicCandidates).chained(consume additionalCandidates), seenCandidates: seenCandidates)
+            .sorted {
+                let count0 = $0.rubyCount
+                let count1 = $1.rubyCount
+                return count0 == count1 ? $0.value > $1.value : count0 > count1
+            }
+        for c in candidates {
+            seenCandidates.insert(c.text)
+        }
+        // 賢く変換するパターン（任意件数）
+        let wiseCandidates = self.getUniqueCandidate(self.getSpecialCandidate(inputData, options: options), seenCandidates: seenCandidates)
+        for c in wiseCandidates {
+            seenCandidates.insert(c.text)
+        }
+        // 途中でwise_candidatesを挟む
+        candidates.insert(contentsOf: consume wiseCandidates, at: min(5, candidates.endIndex))
+        return candidates
+    }
+
     /// 入力からラティスを構築する関数。状況に応じて呼ぶ関数を分ける。
     /// - Parameters:
     ///   - inputData: 変換対象のInputData。
     ///   - N_best: 計算途中で保存する候補数。実際に得られる候補数とは異なる。
+    ///   - cancellation: 別スレッドから変換を中断するためのフラグ。
     /// - Returns:
-    ///   結果のラティスノードと、計算済みノードの全体
-    private func convertToLattice(_ inputData: ComposingText, N_best: Int, zenzaiMode: ConvertRequestOptions.ZenzaiMode, needTypoCorrection: Bool) -> (result: LatticeNode, lattice: Lattice)? {
+    ///   結果のラティスノードと、計算済みノードの全体。中断された場合は`nil`。
+    private func convertToLattice(_ inputData: ComposingText, N_best: Int, zenzaiMode: ConvertRequestOptions.ZenzaiMode, needTypoCorrection: Bool, cancellation: ConversionCancellation?) -> (result: LatticeNode, lattice: Lattice)? {
+        let result = self.constructLattice(inputData, N_best: N_best, zenzaiMode: zenzaiMode, needTypoCorrection: needTypoCorrection, cancellation: cancellation)
+        if cancellation?.isCancelled == true {
+            // 差分更新は前回のラティスをその場で書き換えるため、中断された場合は前回の状態に戻せない
+            // 途中までの状態を次回の差分更新に使わないよう、保持している状態を全て破棄して次回は新規に計算する
+            self.previousInputData = nil
+            self.zenzaiCache = nil
+            self.lattice = .init()
+            self.completedData = nil
+            return nil
+        }
+        return result
+    }
+
+    /// `convertToLattice`の本体。
+    private func constructLattice(_ inputData: ComposingText, N_best: Int, zenzaiMode: ConvertRequestOptions.ZenzaiMode, needTypoCorrection: Bool, cancellation: ConversionCancellation?) -> (result: LatticeNode, lattice: Lattice)? {
         if inputData.convertTarget.isEmpty {
             return nil
         }
+        // 差分更新で使われなくなったノードが溜まりすぎた場合は、前回のラティスを手放して新規に計算する
+        // 文節確定の直後は確定した文節を考慮する必要があるため、次の変換まで待つ
+        if self.converter.latticeArena.count > LatticeArena.retentionLimit && self.completedData == nil {
+            self.zenzaiCache = nil
+            self.previousInputData = nil
+            self.lattice = .init()
+        }
+        // 前回のラティスを保持していなければ、前回の変換で作ったノードの領域を再利用する
+        // 保持している場合は差分更新でそのノードを参照するため、同じ領域に追加し続ける
+        if self.previousInputData == nil && self.zenzaiCache == nil {
+            self.converter.latticeArena.reset()
+        }
 
         // FIXME: enable cache based zenzai
         if zenzaiMode.enabled, let model = self.getModel(modelURL: zenzaiMode.weightURL) {
@@ -693,7 +779,8 @@ public final class KanaKanjiConverter {
                 requestRichCandidates: zenzaiMode.requestRichCandidates,
                 personalizationMode: self.getZenzaiPersonalization(mode: zenzaiMode.personalizationMode),
                 versionDependentConfig: zenzaiMode.versionDependentMode,
-                dicdataStoreState: self.dicdataStoreState
+                dicdataStoreState: self.dicdataStoreState,
+                cancellation: cancellation
             )
             self.zenzaiCache = cache
             self.previousInputData = inputData
@@ -706,7 +793,8 @@ public final class KanaKanjiConverter {
                 inputData,
                 N_best: N_best,
                 needTypoCorrection: needTypoCorrection,
-                dicdataStoreState: self.dicdataStoreState
+                dicdataStoreState: self.dicdataStoreState,
+                cancellation: cancellation
             )
             self.previousInputData = inputData
             return result
@@ -724,7 +812,7 @@ public final class KanaKanjiConverter {
         // 文節確定の後の場合
         if let completedData, previousInputData.inputHasSuffix(inputOf: inputData) {
             debug("\(#function): 文節確定用の関数を呼びます、確定された文節は\(completedData)")
-            let result = converter.kana2lattice_afterComplete(inputData, completedData: completedData, N_best: N_best, previousResult: (inputData: previousInputData, lattice: self.lattice), needTypoCorrection: needTypoCorrection)
+            let result = converter.kana2lattice_afterComplete(inputData, completedData: completedData, N_best: N_best, previousResult: (inputData: previousInputData, lattice: self.lattice), needTypoCorrection: needTypoCorrection, cancellation: cancellation)
             self.previousInputData = inputData
             self.completedData = nil
             return result
@@ -742,7 +830,8 @@ public final class KanaKanjiConverter {
             counts: diff,
             previousResult: (inputData: previousInputData, lattice: self.lattice),
             needTypoCorrection: needTypoCorrection,
-            dicdataStoreState: self.dicdataStoreState
+            dicdataStoreState: self.dicdataStoreState,
+            cancellation: cancellation
         )
         self.previousInputData = inputData
         return result
@@ -767,8 +856,15 @@ public final class KanaKanjiConverter {
     /// - Parameters:
     ///   - inputData: 変換対象のInputData。
     ///   - options: リクエストにかかるパラメータ。
+    ///   - cancellation: 別スレッドから変換を中断するためのフラグ。中断された場合の結果は不完全なため、破棄すること。
+    ///   - deferWordCandidates: `true`の場合、`mainResults`の末尾に続く単語候補などの生成を省略する。
+    ///     候補欄の先頭だけを表示する場合に利用し、残りは`requestDeferredCandidates`で取得する。
     /// - Returns: `ConversionResult`
-    public func requestCandidates(_ inputData: ComposingText, options: ConvertRequestOptions) -> ConversionResult {
+    public func requestCandidates(_ inputData: ComposingText, options: ConvertRequestOptions, cancellation: ConversionCancellation? = nil, deferWordCandidates: Bool = false) -> ConversionResult {
+        let start = LatencyHistogram.now()
+        defer {
+            ConversionStatistics.requestCandidates.record(since: start)
+        }
         debug("requestCandidates 入力は", inputData)
         // 変換対象が無の場合
         if inputData.convertTarget.isEmpty {
@@ -784,11 +880,37 @@ public final class KanaKanjiConverter {
         let needTypoCorrection = options.needTypoCorrection ?? false
         #endif
 
-        guard let result = self.convertToLattice(inputData, N_best: options.N_best, zenzaiMode: options.zenzaiMode, needTypoCorrection: needTypoCorrection) else {
+        guard let result = self.convertToLattice(inputData, N_best: options.N_best, zenzaiMode: options.zenzaiMode, needTypoCorrection: needTypoCorrection, cancellation: cancellation) else {
+            return ConversionResult(mainResults: [], firstClauseResults: [])
+        }
+        if cancellation?.isCancelled == true {
             return ConversionResult(mainResults: [], firstClauseResults: [])
         }
 
-        return self.processResult(inputData: inputData, result: result, options: options)
+        return self.processResult(inputData: inputData, result: result, options: options, deferWordCandidates: deferWordCandidates)
+    }
+
+    /// `requestCandidates`で`deferWordCandidates`を指定して省略した候補を生成する関数。
+    /// - Parameters:
+    ///   - inputData: 直前の`requestCandidates`に与えたInputData。
+    ///   - mainResults: 直前の`requestCandidates`で得た`mainResults`。これらと重複する候補は除かれる。
+    ///   - options: リクエストにかかるパラメータ。
+    /// - Returns: `mainResults`の後ろに続く候補。`inputData`が直前の変換と異なる場合や、直前の変換が単語候補を生成せずに候補を返した場合（完全一致のみを要求した場合など）は空配列。
+    public func requestDeferredCandidates(_ inputData: ComposingText, mainResults: [Candidate], options: ConvertRequestOptions) -> [Candidate] {
+        guard self.hasDeferredWordCandidates, self.previousInputData == inputData, !inputData.convertTarget.isEmpty else {
+            return []
+        }
+        // `processResult`と同じく、完全一致のみを要求する場合は単語候補を生成しない
+        if case .完全一致 = options.requestQuery {
+            return []
+        }
+        var seenCandidates: Set<String> = mainResults.mapSet {$0.text}
+        var result = self.getWordCandidates(inputData, lattice: self.lattice, options: options, seenCandidates: &seenCandidates)
+        result.mutatingForEach { item in
+            item.withActions(self.getAppropriateActions(item))
+            item.parseTemplate()
+        }
+        return result
     }
 
     /// 変換確定後の予測変換候補を要求する関数
@@ -28,6 +28,7 @@ public struct TextReplacer: Sendable {
         var emojiSearchDict: [String: [String]] = [:]
         var emojiGroups: [EmojiGroup] = []
         do {
+            FileAccessCounter.recordOpen()
             let string = try String(contentsOf: emojiDataProvider(), encoding: .utf8)
             let lines = string.components(separatedBy: .newlines)
             for line in lines {
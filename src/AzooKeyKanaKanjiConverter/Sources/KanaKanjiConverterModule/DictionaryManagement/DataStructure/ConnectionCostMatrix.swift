@@ -0,0 +1,96 @@
+import Foundation
+
+/// 全ての左右の品詞IDの組について、連接確率を1つの連続した領域に並べた行列
+///
+/// `DictionaryBuilder.exportConnectionCostMatrix`が書き出した`cb/matrix.ccm`をメモリマップして用いる。
+/// `former`ごとの行が連続して並んでいるため、行の先頭を指すポインタから直接値を読み出せる。
+/// 読み込み時の計算や、変換の途中で行ごとにファイルを読む処理が発生しない。
+final class ConnectionCostMatrix: @unchecked Sendable {
+    /// `cb/`以下に置かれるファイル名
+    static let fileName = "matrix.ccm"
+    /// ファイルの先頭に置かれる識別子
+    private static let magic: [UInt8] = Array("CCMATRX1".utf8)
+    /// ヘッダのバイト数（識別子、行数、予約領域）
+    private static let headerSize = 16
+
+    private init(mapping: NSData, rowCount: Int, values: UnsafeBufferPointer<Float32>) {
+        self.mapping = mapping
+        self.rowCount = rowCount
+        self.values = values
+    }
+
+    /// 領域を所有するデータ。`values`はこの領域内を指す
+    private let mapping: NSData
+    /// 行数。列数も同じ値になる
+    let rowCount: Int
+    private let values: UnsafeBufferPointer<Float32>
+
+    /// メモリマップした`cb/matrix.ccm`の内容から行列を構築する
+    /// - Parameter mapping: ファイルの内容
+    /// - Returns: 形式が不正な場合は`nil`を返す。
+    convenience init?(mapping: NSData) {
+        #if _endian(big)
+        // ファイルはリトルエンディアンで記録されている
+        return nil
+        #else
+        let base = mapping.bytes
+        let length = mapping.length
+        guard length >= Self.headerSize,
+              Int(bitPattern: base) % MemoryLayout<Float32>.alignment == 0,
+              Self.magic.indices.allSatisfy({ base.load(fromByteOffset: $0, as: UInt8.self) == Self.magic[$0] }) else {
+            return nil
+        }
+        let rowCount = Int(base.load(fromByteOffset: 8, as: UInt32.self))
+        guard length == Self.headerSize + rowCount * rowCount * MemoryLayout<Float32>.size else {
+            return nil
+        }
+        self.init(
+            mapping: mapping,
+            rowCount: rowCount,
+            values: UnsafeBufferPointer(start: (base + Self.headerSize).assumingMemoryBound(to: Float32.self), count: rowCount * rowCount)
+        )
+        #endif
+    }
+
+    /// `dictionaryURL`以下の`cb/matrix.ccm`をメモリマップして読み込む
+    /// - Returns: ファイルが存在しない場合や、形式が不正な場合は`nil`を返す。
+    static func load(dictionaryURL: URL) -> ConnectionCostMatrix? {
+        let url = dictionaryURL.appendingPathComponent("cb/\(Self.fileName)", isDirectory: false)
+        guard FileManager.default.fileExists(atPath: url.path) else {
+            return nil
+        }
+        do {
+            FileAccessCounter.recordOpen()
+            let mapping = try NSData(contentsOf: url, options: [.alwaysMapped])
+            guard let matrix = ConnectionCostMatrix(mapping: mapping) else {
+                debug("Error: \(url)の形式が不正です。`cb/`以下の各行のファイルから読み込みます。")
+                return nil
+            }
+            return matrix
+        } catch {
+            debug(#function, error)
+            return nil
+        }
+    }
+
+    /// `former`に対応する行。`latter`番目の要素が連接確率の対数になる
+    func row(_ former: Int) -> UnsafeBufferPointer<Float32> {
+        UnsafeBufferPointer(rebasing: self.values[former * self.rowCount ..< (former + 1) * self.rowCount])
+    }
+
+    /// `cb/matrix.ccm`形式のバイナリを生成する
+    /// - Parameter rows: 各行の値。全ての行は行数と同じ長さである必要がある
+    static func fileData(rows: [[Float32]]) -> Data {
+        precondition(rows.allSatisfy { $0.count == rows.count }, "connection cost matrix must be square")
+        var data = Data(capacity: Self.headerSize + rows.count * rows.count * MemoryLayout<Float32>.size)
+        data.append(contentsOf: Self.magic)
+        withUnsafeBytes(of: UInt32(rows.count).littleEndian) { data.append(contentsOf: $0) }
+        data.append(contentsOf: [UInt8](repeating: 0, count: Self.headerSize - data.count))
+        for row in rows {
+            for value in row {
+                withUnsafeBytes(of: value.bitPattern.littleEndian) { data.append(contentsOf: $0) }
+            }
+        }
+        return data
+    }
+}
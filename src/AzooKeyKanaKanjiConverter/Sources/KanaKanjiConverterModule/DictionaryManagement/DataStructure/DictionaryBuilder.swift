@@ -9,12 +9,15 @@ public enum DictionaryBuilder {
     public static let entriesPerShard: Int = 1 << shardShift
     /// Bit mask for local index (only valid if entriesPerShard is power of two).
     public static let localMask: Int = entriesPerShard - 1
+    /// Identifier of the combined trie written by `exportUnifiedDictionary`.
+    public static let unifiedIdentifier: String = "unified"
     /// Export a dictionary from DicdataElement entries into LOUDS and loudstxt3 files.
     /// - Parameters:
     ///   - entries: DicdataElement list (ruby must be consistent form, typically Katakana).
     ///   - directoryURL: Target directory for outputs.
     ///   - baseName: Base file name when not sharding (e.g., "user").
-    ///   - shardByFirstCharacter: When true, writes per-first-character files like the default dictionary layout.
+    ///   - shardByFirstCharacter: When true, writes per-first-character files like the default dictionary layout,
+    ///     including a memory-mappable `.loudsx` file and a `.loudsmax` prediction score table for each shard.
     ///   - char2UInt8: Character-ID mapping matching `charID.chid`.
     public static func exportDictionary(
         entries: [DicdataElement],
@@ -25,52 +28,204 @@ public enum DictionaryBuilder {
         shardShift customShardShift: Int? = nil
     ) throws {
         let effectiveShardShift = customShardShift ?? Self.shardShift
-        let effectiveEntriesPerShard = 1 << effectiveShardShift
-        let effectiveLocalMask = effectiveEntriesPerShard - 1
         if shardByFirstCharacter {
             let groupedByFirst: [Character: [DicdataElement]] = Dictionary(grouping: entries) { e in e.ruby.first ?? "\0" }
             for (fc, group) in groupedByFirst.sorted(by: { $0.key < $1.key }) {
-                let id = escapedIdentifier(String(fc))
-                let loudsURL = directoryURL.appendingPathComponent("\(id).louds")
-                let charsURL = directoryURL.appendingPathComponent("\(id).loudschars2")
-                let (bits, chars) = buildLOUDS(entries: group, char2UInt8: char2UInt8)
-                try writeLOUDS(bits: bits, nodes2Characters: chars, loudsURL: loudsURL, loudsChars2URL: charsURL)
-                // loudstxt3 shards aligned to LOUDS node indices (entriesPerShard slots per shard)
-                let words = makeLOUDSWords(bits: bits)
-                let louds = LOUDS(bytes: words, nodeIndex2ID: chars)
-                try writeLoudstxt3ShardsAligned(
+                try exportLOUDS(
                     entries: group,
-                    id: id,
-                    louds: louds,
-                    char2UInt8: char2UInt8,
+                    id: escapedIdentifier(String(fc)),
                     directoryURL: directoryURL,
-                    shardShift: effectiveShardShift,
-                    entriesPerShard: effectiveEntriesPerShard,
-                    localMask: effectiveLocalMask
+                    char2UInt8: char2UInt8,
+                    writesMappedFile: true,
+                    shardShift: effectiveShardShift
                 )
             }
         } else {
-            let id = baseName
-            let loudsURL = directoryURL.appendingPathComponent("\(id).louds")
-            let charsURL = directoryURL.appendingPathComponent("\(id).loudschars2")
-            let (bits, chars) = buildLOUDS(entries: entries, char2UInt8: char2UInt8)
-            try writeLOUDS(bits: bits, nodes2Characters: chars, loudsURL: loudsURL, loudsChars2URL: charsURL)
-            // loudstxt3 shards aligned to LOUDS node indices
-            let words = makeLOUDSWords(bits: bits)
-            let louds = LOUDS(bytes: words, nodeIndex2ID: chars)
-            try writeLoudstxt3ShardsAligned(
+            try exportLOUDS(
                 entries: entries,
-                id: id,
-                louds: louds,
-                char2UInt8: char2UInt8,
+                id: baseName,
                 directoryURL: directoryURL,
-                shardShift: effectiveShardShift,
-                entriesPerShard: effectiveEntriesPerShard,
-                localMask: effectiveLocalMask
+                char2UInt8: char2UInt8,
+                writesMappedFile: false,
+                shardShift: effectiveShardShift
             )
         }
     }
 
+    /// Figures reported by `exportDictionaryConcurrently`.
+    public struct BuildMetrics: Sendable {
+        /// Number of per-first-character tries written.
+        public var trieCount: Int
+        /// Number of input entries.
+        public var entryCount: Int
+        /// Number of files written (`.louds`, `.loudschars2`, `.loudsx`, `.loudsmax` and loudstxt3 shards).
+        public var fileCount: Int
+        /// Total size of the written files in bytes.
+        public var byteCount: Int
+        /// Wall-clock time of the whole export in seconds.
+        public var elapsedSeconds: Double
+        /// Sum of the time spent on each trie in seconds. Compare with `elapsedSeconds` to see the effective parallelism.
+        public var trieSeconds: Double
+    }
+
+    /// Parallel variant of `exportDictionary(... shardByFirstCharacter: true ...)`.
+    ///
+    /// Each first character is built and written by a child task, with at most `maxConcurrency` tries in flight.
+    /// Every trie writes only its own files through the same code path as the serial builder, so the output is byte-identical.
+    /// - Parameters:
+    ///   - entries: DicdataElement list (ruby must be consistent form, typically Katakana).
+    ///   - directoryURL: Target directory for outputs.
+    ///   - char2UInt8: Character-ID mapping matching `charID.chid`.
+    ///   - maxConcurrency: Upper bound of tries built at the same time.
+    public static func exportDictionaryConcurrently(
+        entries: [DicdataElement],
+        to directoryURL: URL,
+        char2UInt8: [Character: UInt8],
+        maxConcurrency: Int = ProcessInfo.processInfo.activeProcessorCount,
+        shardShift customShardShift: Int? = nil
+    ) async throws -> BuildMetrics {
+        let start = Date()
+        let effectiveShardShift = customShardShift ?? Self.shardShift
+        // larger groups first so that a long trie does not start last
+        let groups = Dictionary(grouping: entries) { e in e.ruby.first ?? "\0" }
+            .sorted { ($0.value.count, $1.key) > ($1.value.count, $0.key) }
+        var metrics = BuildMetrics(trieCount: groups.count, entryCount: entries.count, fileCount: 0, byteCount: 0, elapsedSeconds: 0, trieSeconds: 0)
+        try await withThrowingTaskGroup(of: (fileCount: Int, byteCount: Int, seconds: Double).self) { group in
+            var pending = groups.makeIterator()
+            func addNext() {
+                guard let next = pending.next() else {
+                    return
+                }
+                let (fc, chunk) = (next.key, next.value)
+                group.addTask {
+                    let start = Date()
+                    let written = try Self.exportLOUDS(
+                        entries: chunk,
+                        id: Self.escapedIdentifier(String(fc)),
+                        directoryURL: directoryURL,
+                        char2UInt8: char2UInt8,
+                        writesMappedFile: true,
+                        shardShift: effectiveShardShift
+                    )
+                    return (written.fileCount, written.byteCount, Date().timeIntervalSince(start))
+                }
+            }
+            for _ in 0 ..< max(maxConcurrency, 1) {
+                addNext()
+            }
+            while let result = try await group.next() {
+                metrics.fileCount += result.fileCount
+                metrics.byteCount += result.byteCount
+                metrics.trieSeconds += result.seconds
+                addNext()
+            }
+        }
+        metrics.elapsedSeconds = Date().timeIntervalSince(start)
+        return metrics
+    }
+
+    /// Export the default dictionary as one combined LOUDS trie instead of one trie per first character.
+    ///
+    /// All entries share a single `.louds`/`.loudschars2`/`.loudsx` set and loudstxt3 shards named after `unifiedIdentifier`.
+    /// `DicdataStore` prefers this trie whenever it is present in the dictionary directory.
+    /// - Parameters:
+    ///   - entries: DicdataElement list (ruby must be consistent form, typically Katakana).
+    ///   - directoryURL: Target directory for outputs.
+    ///   - char2UInt8: Character-ID mapping matching `charID.chid`.
+    public static func exportUnifiedDictionary(
+        entries: [DicdataElement],
+        to directoryURL: URL,
+        char2UInt8: [Character: UInt8],
+        shardShift customShardShift: Int? = nil
+    ) throws {
+        try exportLOUDS(
+            entries: entries,
+            id: unifiedIdentifier,
+            directoryURL: directoryURL,
+            char2UInt8: char2UInt8,
+            writesMappedFile: true,
+            shardShift: customShardShift ?? Self.shardShift
+        )
+    }
+
+    /// Combine the per-row connection cost files `cb/<former>.binary` into one dense matrix `cb/matrix.ccm`.
+    ///
+    /// `DicdataStore` memory-maps the matrix when present instead of reading each row file on first use.
+    /// Rows without a file get the same fallback cost (-25) that `DicdataStore` uses for them.
+    /// - Parameters:
+    ///   - dictionaryURL: Dictionary directory that contains `cb/`.
+    ///   - rowCount: Number of class ids (rows and columns of the matrix).
+    public static func exportConnectionCostMatrix(dictionaryURL: URL, rowCount: Int = 1319) throws {
+        let cbURL = dictionaryURL.appendingPathComponent("cb", isDirectory: true)
+        var rows: [[Float32]] = []
+        rows.reserveCapacity(rowCount)
+        for former in 0 ..< rowCount {
+            let url = cbURL.appendingPathComponent("\(former).binary", isDirectory: false)
+            guard FileManager.default.fileExists(atPath: url.path) else {
+                rows.append([Float32](repeating: -25, count: rowCount))
+                continue
+            }
+            // (Int32 latter, Float32 cost) pairs; the first pair has latter == -1 and holds the row default
+            let data = try Data(contentsOf: url)
+            let pairs: [(latter: Int32, cost: Float32)] = data.withUnsafeBytes { buffer in
+                (0 ..< buffer.count / 8).map {
+                    (buffer.loadUnaligned(fromByteOffset: $0 * 8, as: Int32.self), buffer.loadUnaligned(fromByteOffset: $0 * 8 + 4, as: Float32.self))
+                }
+            }
+            guard let first = pairs.first else {
+                rows.append([Float32](repeating: -25, count: rowCount))
+                continue
+            }
+            var row = [Float32](repeating: first.cost, count: rowCount)
+            for (latter, cost) in pairs.dropFirst() where (0 ..< rowCount).contains(Int(latter)) {
+                row[Int(latter)] = cost
+            }
+            rows.append(row)
+        }
+        try ConnectionCostMatrix.fileData(rows: rows).write(to: cbURL.appendingPathComponent(ConnectionCostMatrix.fileName, isDirectory: false), options: .atomic)
+    }
+
+    /// Write one LOUDS trie (and optionally its `.loudsx`) plus the aligned loudstxt3 shards under `id`.
+    /// - Returns: Number of files and bytes written.
+    @discardableResult
+    private static func exportLOUDS(entries: [DicdataElement], id: String, directoryURL: URL, char2UInt8: [Character: UInt8], writesMappedFile: Bool, shardShift: Int) throws -> (fileCount: Int, byteCount: Int) {
+        let entriesPerShard = 1 << shardShift
+        let loudsURL = directoryURL.appendingPathComponent("\(id).louds")
+        let charsURL = directoryURL.appendingPathComponent("\(id).loudschars2")
+        let (bits, chars) = buildLOUDS(entries: entries, char2UInt8: char2UInt8)
+        try writeLOUDS(bits: bits, nodes2Characters: chars, loudsURL: loudsURL, loudsChars2URL: charsURL)
+        var fileCount = 2
+        var byteCount = (bits.count + 63) / 64 * MemoryLayout<UInt64>.size + chars.count
+        // loudstxt3 shards aligned to LOUDS node indices (entriesPerShard slots per shard)
+        let words = makeLOUDSWords(bits: bits)
+        let louds = LOUDS(bytes: words, nodeIndex2ID: chars)
+        if writesMappedFile {
+            // memory-mappable LOUDS with precomputed rank and char-index tables
+            let mappedData = louds.mappedFileData()
+            try mappedData.write(to: directoryURL.appendingPathComponent("\(id).loudsx"))
+            fileCount += 1
+            byteCount += mappedData.count
+        }
+        let shards = try writeLoudstxt3ShardsAligned(
+            entries: entries,
+            id: id,
+            louds: louds,
+            char2UInt8: char2UInt8,
+            directoryURL: directoryURL,
+            shardShift: shardShift,
+            entriesPerShard: entriesPerShard,
+            localMask: entriesPerShard - 1
+        )
+        if writesMappedFile {
+            // per-node best prediction scores for ranked prefix search
+            let scoreData = PredictionScoreIndex.fileData(louds: louds, ownScores: shards.predictionScores)
+            try scoreData.write(to: directoryURL.appendingPathComponent("\(id).\(PredictionScoreIndex.fileExtension)"))
+            fileCount += 1
+            byteCount += scoreData.count
+        }
+        return (fileCount + shards.fileCount, byteCount + shards.byteCount)
+    }
+
     /// Convenience overload: load `charID.chid`-style mapping from a file.
     public static func exportDictionary(
         entries: [DicdataElement],
@@ -158,10 +313,10 @@ public enum DictionaryBuilder {
     ///   Example: "あ" -> "[3042]", "AB" -> "[0041_0042]", "🇯🇵" -> "[D83C_DDEF_D83C_DDF5]"
     ///   - BMP scalars: single 4-hex chunk
     ///   - Non-BMP scalars: surrogate pair (two chunks)
-    /// - Special cases: "user", "memory", and "user_shortcuts" are returned as-is
+    /// - Special cases: "user", "memory", "user_shortcuts", and `unifiedIdentifier` are returned as-is
     static func escapedIdentifier(_ inputIdentifier: String) -> String {
         switch inputIdentifier {
-        case "user", "memory", "user_shortcuts":
+        case "user", "memory", "user_shortcuts", unifiedIdentifier:
             return inputIdentifier
         default:
             break
@@ -189,10 +344,12 @@ public enum DictionaryBuilder {
         try charsData.write(to: loudsChars2URL)
     }
 
-    private static func writeLoudstxt3ShardsAligned(entries: [DicdataElement], id: String, louds: LOUDS, char2UInt8: [Character: UInt8], directoryURL: URL, shardShift: Int, entriesPerShard: Int, localMask: Int) throws {
+    /// - Returns: Number of files and bytes written, and the best score of prediction-usable rows for each node.
+    private static func writeLoudstxt3ShardsAligned(entries: [DicdataElement], id: String, louds: LOUDS, char2UInt8: [Character: UInt8], directoryURL: URL, shardShift: Int, entriesPerShard: Int, localMask: Int) throws -> (fileCount: Int, byteCount: Int, predictionScores: [Int: Float32]) {
         // Group entries by ruby, compute their LOUDS node index, and shard by (index >> shardShift)
         let grouped = Dictionary(grouping: entries, by: { $0.ruby })
         var shards: [Int: [(local: Int, ruby: String, rows: [Loudstxt3Builder.Row])]] = [:]
+        var predictionScores: [Int: Float32] = [:]
         for (ruby, elems) in grouped {
             // Map ruby to char IDs
             var ids: [UInt8] = []
@@ -214,11 +371,17 @@ public enum DictionaryBuilder {
                 Loudstxt3Builder.Row(word: e.word, lcid: e.lcid, rcid: e.rcid, mid: e.mid, score: Float32(e.value()))
             }
             shards[shard, default: []].append((local: local, ruby: ruby, rows: rows))
+            let usableScores = rows.lazy.filter { DicdataStore.predictionUsable.indices.contains($0.rcid) && DicdataStore.predictionUsable[$0.rcid] }.map(\.score)
+            if let best = usableScores.max() {
+                predictionScores[nodeIndex] = best
+            }
         }
+        var byteCount = 0
         for (shard, items) in shards.sorted(by: { $0.key < $1.key }) {
             let url = directoryURL.appendingPathComponent("\(id)\(shard).loudstxt3")
-            try Loudstxt3Builder.writeAligned(items: items, to: url, entriesPerShard: entriesPerShard)
+            byteCount += try Loudstxt3Builder.writeAligned(items: items, to: url, entriesPerShard: entriesPerShard)
         }
+        return (shards.count, byteCount, predictionScores)
     }
 
     private static func buildLOUDS(entries: [DicdataElement], char2UInt8: [Character: UInt8]) -> (bits: [Bool], nodes2Characters: [UInt8]) {
@@ -289,89 +452,76 @@ enum Loudstxt3Builder {
     /// Make loudstxt3 binary from grouped entries per ruby key.
     /// Each element represents one node (one ruby string) and its rows.
     static func makeBinary(entries: [(ruby: String, rows: [Row])]) -> Data {
-        let lc = entries.count
-        var body = Data()
-        body.reserveCapacity(lc * 64)
-        // Build per-entry payloads
-        var payloads: [Data] = []
-        payloads.reserveCapacity(lc)
-        for entry in entries {
-            var d = Data()
-            var count = UInt16(entry.rows.count)
-            d.append(Data(bytes: &count, count: MemoryLayout<UInt16>.size))
-            // numeric rows
-            for row in entry.rows {
-                var lcid = UInt16(row.lcid)
-                var rcid = UInt16(row.rcid)
-                var mid = UInt16(row.mid)
-                var score = Float32(row.score)
-                d.append(Data(bytes: &lcid, count: MemoryLayout<UInt16>.size))
-                d.append(Data(bytes: &rcid, count: MemoryLayout<UInt16>.size))
-                d.append(Data(bytes: &mid, count: MemoryLayout<UInt16>.size))
-                d.append(Data(bytes: &score, count: MemoryLayout<Float32>.size))
+        makeFile(slotCount: entries.count) { entries[$0] }
+    }
+
+    /// High-level: write a loudstxt3 file with entriesPerShard header slots aligned to LOUDS local indices.
+    /// - Parameter items: list of (local index, ruby, rows) for this shard.
+    @discardableResult
+    static func writeAligned(items: [(local: Int, ruby: String, rows: [Row])], to url: URL, entriesPerShard: Int) throws -> Int {
+        var slots: [Int?] = Array(repeating: nil, count: entriesPerShard)
+        for (i, item) in items.enumerated() where (0 ..< entriesPerShard).contains(item.local) {
+            slots[item.local] = i
+        }
+        // Empty slots get a zero-count payload so they are valid to parse.
+        let data = makeFile(slotCount: entriesPerShard) { local in
+            slots[local].map { (items[$0].ruby, items[$0].rows) }
+        }
+        try data.write(to: url, options: .atomic)
+        return data.count
+    }
+
+    /// Serialize `slotCount` node payloads into one loudstxt3 binary.
+    ///
+    /// Payloads are written into a single growing byte buffer instead of allocating a `Data` per row or per field.
+    /// - Parameter payload: (ruby, rows) for the slot, or `nil` for an empty slot (row count 0).
+    private static func makeFile(slotCount: Int, payload: (Int) -> (ruby: String, rows: [Row])?) -> Data {
+        var body: [UInt8] = []
+        body.reserveCapacity(slotCount * 64)
+        var offsets: [Int] = []
+        offsets.reserveCapacity(slotCount)
+        for slot in 0 ..< slotCount {
+            offsets.append(body.count)
+            if let entry = payload(slot) {
+                appendPayload(ruby: entry.ruby, rows: entry.rows, to: &body)
+            } else {
+                append(UInt16(0), to: &body)
             }
-            // text area: ruby + words (empty string when equals ruby), separated by tab
-            let text = ([entry.ruby] + entry.rows.map { $0.word == entry.ruby ? "" : $0.word }).joined(separator: "\t")
-            d.append(text.data(using: .utf8, allowLossyConversion: false)!)
-            payloads.append(d)
         }
-        // header count (UInt16)
-        var count16 = UInt16(lc)
-        var result = Data()
-        result.append(Data(bytes: &count16, count: MemoryLayout<UInt16>.size))
-        // header offsets (UInt32), cumulative — include all lc offsets
-        var offset: UInt32 = 2 + UInt32(lc) * UInt32(MemoryLayout<UInt32>.size)
-        for i in 0 ..< lc {
-            result.append(Data(bytes: &offset, count: MemoryLayout<UInt32>.size))
-            offset &+= UInt32(payloads[i].count)
+        let headerSize = 2 + slotCount * MemoryLayout<UInt32>.size
+        var header: [UInt8] = []
+        header.reserveCapacity(headerSize)
+        // header count (UInt16) followed by cumulative offsets (UInt32) of all slots
+        append(UInt16(slotCount), to: &header)
+        for offset in offsets {
+            append(UInt32(truncatingIfNeeded: headerSize + offset), to: &header)
         }
-        // body
-        for p in payloads { result.append(p) }
+        var result = Data(capacity: headerSize + body.count)
+        result.append(contentsOf: header)
+        result.append(contentsOf: body)
         return result
     }
 
-    /// High-level: write a loudstxt3 file with entriesPerShard header slots aligned to LOUDS local indices.
-    /// - Parameter items: list of (local index, ruby, rows) for this shard.
-    static func writeAligned(items: [(local: Int, ruby: String, rows: [Row])], to url: URL, entriesPerShard: Int) throws {
-        // Initialize each slot with a zero-count (2 bytes) payload so empty slots are valid to parse.
-        var payloads: [Data] = Array(repeating: {
-            var z: UInt16 = 0
-            return Data(bytes: &z, count: MemoryLayout<UInt16>.size)
-        }(), count: entriesPerShard)
-        for item in items {
-            guard (0 ..< entriesPerShard).contains(item.local) else {
-                continue
-            }
-            var d = Data()
-            var count = UInt16(item.rows.count)
-            d.append(Data(bytes: &count, count: MemoryLayout<UInt16>.size))
-            for row in item.rows {
-                var lcid = UInt16(row.lcid)
-                var rcid = UInt16(row.rcid)
-                var mid = UInt16(row.mid)
-                var score = Float32(row.score)
-                d.append(Data(bytes: &lcid, count: MemoryLayout<UInt16>.size))
-                d.append(Data(bytes: &rcid, count: MemoryLayout<UInt16>.size))
-                d.append(Data(bytes: &mid, count: MemoryLayout<UInt16>.size))
-                d.append(Data(bytes: &score, count: MemoryLayout<Float32>.size))
-            }
-            let text = ([item.ruby] + item.rows.map { $0.word == item.ruby ? "" : $0.word }).joined(separator: "\t")
-            d.append(text.data(using: .utf8, allowLossyConversion: false)!)
-            payloads[item.local] = d
+    /// Append one node payload: row count, numeric rows, then ruby and words (empty when equal to ruby) separated by tab.
+    private static func appendPayload(ruby: String, rows: [Row], to buffer: inout [UInt8]) {
+        append(UInt16(rows.count), to: &buffer)
+        for row in rows {
+            append(UInt16(row.lcid), to: &buffer)
+            append(UInt16(row.rcid), to: &buffer)
+            append(UInt16(row.mid), to: &buffer)
+            append(Float32(row.score), to: &buffer)
         }
-        // Build header
-        var result = Data()
-        var count16 = UInt16(entriesPerShard)
-        result.append(Data(bytes: &count16, count: MemoryLayout<UInt16>.size))
-        // write offsets for all slots
-        var offset: UInt32 = 2 + UInt32(entriesPerShard) * UInt32(MemoryLayout<UInt32>.size)
-        for i in 0 ..< entriesPerShard {
-            result.append(Data(bytes: &offset, count: MemoryLayout<UInt32>.size))
-            offset &+= UInt32(payloads[i].count)
+        buffer.append(contentsOf: ruby.utf8)
+        for row in rows {
+            buffer.append(UInt8(ascii: "\t"))
+            if row.word != ruby {
+                buffer.append(contentsOf: row.word.utf8)
+            }
         }
-        // Body
-        for p in payloads { result.append(p) }
-        try result.write(to: url, options: .atomic)
+    }
+
+    private static func append<T>(_ value: T, to buffer: inout [UInt8]) {
+        withUnsafeBytes(of: value) { buffer.append(contentsOf: $0) }
     }
 
     /// Backward-compatible wrapper for default entriesPerShard.
@@ -14,22 +14,201 @@ package struct LOUDS: Sendable {
     private static let unit = 64
     private static let uExp = 6
 
-    private let bits: [Unit]
+    /// ビット列と検索用の表の実体
+    ///
+    /// `.loudsx`ファイルから読み込んだ場合はメモリマップした領域をそのまま参照し、コピーを行わない。
+    /// それ以外の場合はヒープに確保した領域を保持し、解放もこのクラスが担う。
+    private final class Storage: @unchecked Sendable {
+        init(bits: UnsafeBufferPointer<Unit>, flatChar2nodeIndices: UnsafeBufferPointer<UInt32>, flatChar2nodeIndicesIndex: UnsafeBufferPointer<UInt32>, rankLarge: UnsafeBufferPointer<UInt32>, selectHints: UnsafeBufferPointer<UInt32>, mapping: NSData?) {
+            self.bits = bits
+            self.flatChar2nodeIndices = flatChar2nodeIndices
+            self.flatChar2nodeIndicesIndex = flatChar2nodeIndicesIndex
+            self.rankLarge = rankLarge
+            self.selectHints = selectHints
+            self.mapping = mapping
+        }
+
+        /// 配列の内容をヒープにコピーして保持する
+        convenience init(bits: [Unit], flatChar2nodeIndices: [UInt32], flatChar2nodeIndicesIndex: [UInt32], rankLarge: [UInt32], selectHints: [UInt32]) {
+            func copy<T>(_ array: [T]) -> UnsafeBufferPointer<T> {
+                let buffer = UnsafeMutableBufferPointer<T>.allocate(capacity: array.count)
+                _ = buffer.initialize(from: array)
+                return UnsafeBufferPointer(buffer)
+            }
+            self.init(
+                bits: copy(bits),
+                flatChar2nodeIndices: copy(flatChar2nodeIndices),
+                flatChar2nodeIndicesIndex: copy(flatChar2nodeIndicesIndex),
+                rankLarge: copy(rankLarge),
+                selectHints: copy(selectHints),
+                mapping: nil
+            )
+        }
+
+        deinit {
+            // メモリマップの場合は`mapping`の解放とともに領域も解放される
+            if mapping == nil {
+                bits.deallocate()
+                flatChar2nodeIndices.deallocate()
+                flatChar2nodeIndicesIndex.deallocate()
+                rankLarge.deallocate()
+                selectHints.deallocate()
+            }
+        }
+
+        let bits: UnsafeBufferPointer<Unit>
+        let flatChar2nodeIndices: UnsafeBufferPointer<UInt32>
+        let flatChar2nodeIndicesIndex: UnsafeBufferPointer<UInt32>
+        let rankLarge: UnsafeBufferPointer<UInt32>
+        let selectHints: UnsafeBufferPointer<UInt32>
+        private let mapping: NSData?
+    }
+
+    private let storage: Storage
+
+    private var bits: UnsafeBufferPointer<Unit> {
+        self.storage.bits
+    }
     /// indexを並べてflattenしたArray。
     ///  - seealso: flatChar2nodeIndicesIndex
-    private let flatChar2nodeIndices: [Int]
+    private var flatChar2nodeIndices: UnsafeBufferPointer<UInt32> {
+        self.storage.flatChar2nodeIndices
+    }
     /// 256個の値を入れるArray。`flatChar2nodeIndices[flatChar2nodeIndicesIndex[char - 1] ..< flatChar2nodeIndicesIndex[char]]`が`nodeIndices`になる
-    private let flatChar2nodeIndicesIndex: [Int]
+    private var flatChar2nodeIndicesIndex: UnsafeBufferPointer<UInt32> {
+        self.storage.flatChar2nodeIndicesIndex
+    }
     /// 0の数（1の数ではない）
     ///
     /// LOUDSのサイズが4GBまでは`UInt32`で十分
-    private let rankLarge: [UInt32]
+    private var rankLarge: UnsafeBufferPointer<UInt32> {
+        self.storage.rankLarge
+    }
+    /// `selectSampleShift`で決まる個数ごとに0を標本化し、その0を含む`bits`のindexを並べたArray
+    ///
+    /// `selectHints[s]`は`(s << selectSampleShift) + 1`番目の0を含む。末尾には番兵として`bits`の最後のindexを置く。
+    private var selectHints: UnsafeBufferPointer<UInt32> {
+        self.storage.selectHints
+    }
+    /// 0を標本化する間隔（2の冪の指数）
+    private static let selectSampleShift = 8
+
+    /// ノード数（番兵のノードを含む）
+    var nodeCount: Int {
+        self.flatChar2nodeIndices.count
+    }
 
     @inlinable init(bytes: [UInt64], nodeIndex2ID: [UInt8]) {
-        self.bits = bytes
+        let tables = Self.makeTables(bytes: bytes, nodeIndex2ID: nodeIndex2ID)
+        self.storage = Storage(
+            bits: bytes,
+            flatChar2nodeIndices: tables.flatChar2nodeIndices,
+            flatChar2nodeIndicesIndex: tables.flatChar2nodeIndicesIndex,
+            rankLarge: tables.rankLarge,
+            selectHints: tables.selectHints
+        )
+    }
+
+    /// メモリマップした`.loudsx`ファイルの領域からLOUDSを構築する
+    ///
+    /// 各ポインタは`mapping`の領域内を指している必要がある。
+    private init(mapping: NSData, bits: UnsafeBufferPointer<Unit>, flatChar2nodeIndices: UnsafeBufferPointer<UInt32>, flatChar2nodeIndicesIndex: UnsafeBufferPointer<UInt32>, rankLarge: UnsafeBufferPointer<UInt32>, selectHints: UnsafeBufferPointer<UInt32>) {
+        self.storage = Storage(
+            bits: bits,
+            flatChar2nodeIndices: flatChar2nodeIndices,
+            flatChar2nodeIndicesIndex: flatChar2nodeIndicesIndex,
+            rankLarge: rankLarge,
+            selectHints: selectHints,
+            mapping: mapping
+        )
+    }
+
+    /// `.loudsx`ファイルの先頭に置かれる識別子
+    private static let mappedFileMagic: [UInt8] = Array("LOUDSX02".utf8)
+    /// `.loudsx`ファイルのヘッダのバイト数（識別子、ビット列の語数、ノード数、`selectHints`の個数）
+    private static let mappedFileHeaderSize = 32
+
+    /// `.loudsx`ファイル内の各領域の開始位置
+    private static func mappedFileLayout(wordCount: Int, nodeCount: Int, hintCount: Int) -> (rankLarge: Int, index: Int, nodes: Int, selectHints: Int, end: Int) {
+        let rankLarge = mappedFileHeaderSize + wordCount * MemoryLayout<Unit>.size
+        // 後続の領域を8バイト境界に揃える
+        let index = rankLarge + (((wordCount + 1) * MemoryLayout<UInt32>.size + 7) & ~7)
+        let nodes = index + 256 * MemoryLayout<UInt32>.size
+        let selectHints = nodes + nodeCount * MemoryLayout<UInt32>.size
+        return (rankLarge, index, nodes, selectHints, selectHints + hintCount * MemoryLayout<UInt32>.size)
+    }
+
+    /// メモリマップした`.loudsx`ファイルの内容からLOUDSを構築する
+    ///
+    /// 検索用の表はファイルに格納済みのものをそのまま参照するため、読み込み時の計算やコピーは発生しない。
+    /// - Parameter mapping: `.loudsx`ファイルの内容
+    /// - Returns: 形式が不正な場合は`nil`を返す。
+    init?(mapping: NSData) {
+        #if _endian(big)
+        // ファイルはリトルエンディアンで記録されている
+        return nil
+        #else
+        let base = mapping.bytes
+        let length = mapping.length
+        guard length >= Self.mappedFileHeaderSize,
+              Int(bitPattern: base) % MemoryLayout<Unit>.alignment == 0,
+              Self.mappedFileMagic.indices.allSatisfy({ base.load(fromByteOffset: $0, as: UInt8.self) == Self.mappedFileMagic[$0] }) else {
+            return nil
+        }
+        let wordCount = Int(truncatingIfNeeded: base.load(fromByteOffset: 8, as: UInt64.self))
+        let nodeCount = Int(truncatingIfNeeded: base.load(fromByteOffset: 16, as: UInt64.self))
+        let hintCount = Int(truncatingIfNeeded: base.load(fromByteOffset: 24, as: UInt64.self))
+        guard (0 ... length / MemoryLayout<Unit>.size).contains(wordCount),
+              (0 ... length / MemoryLayout<UInt32>.size).contains(nodeCount),
+              (1 ... length / MemoryLayout<UInt32>.size).contains(hintCount) else {
+            return nil
+        }
+        let layout = Self.mappedFileLayout(wordCount: wordCount, nodeCount: nodeCount, hintCount: hintCount)
+        guard layout.end == length else {
+            return nil
+        }
+        let flatChar2nodeIndicesIndex = UnsafeBufferPointer(start: (base + layout.index).assumingMemoryBound(to: UInt32.self), count: 256)
+        guard flatChar2nodeIndicesIndex[255] == nodeCount else {
+            return nil
+        }
+        self.init(
+            mapping: mapping,
+            bits: UnsafeBufferPointer(start: (base + Self.mappedFileHeaderSize).assumingMemoryBound(to: Unit.self), count: wordCount),
+            flatChar2nodeIndices: UnsafeBufferPointer(start: (base + layout.nodes).assumingMemoryBound(to: UInt32.self), count: nodeCount),
+            flatChar2nodeIndicesIndex: flatChar2nodeIndicesIndex,
+            rankLarge: UnsafeBufferPointer(start: (base + layout.rankLarge).assumingMemoryBound(to: UInt32.self), count: wordCount + 1),
+            selectHints: UnsafeBufferPointer(start: (base + layout.selectHints).assumingMemoryBound(to: UInt32.self), count: hintCount)
+        )
+        #endif
+    }
+
+    /// `.loudsx`形式のバイナリを生成する
+    ///
+    /// ビット列とあわせて、読み込み時に構築していた`rankLarge`、`flatChar2nodeIndices`、`selectHints`の表を記録する。
+    func mappedFileData() -> Data {
+        let layout = Self.mappedFileLayout(wordCount: self.bits.count, nodeCount: self.flatChar2nodeIndices.count, hintCount: self.selectHints.count)
+        var data = Data(capacity: layout.end)
+        func append<T: FixedWidthInteger>(_ values: some Sequence<T>) {
+            for value in values {
+                withUnsafeBytes(of: value.littleEndian) { data.append(contentsOf: $0) }
+            }
+        }
+        data.append(contentsOf: Self.mappedFileMagic)
+        append([UInt64(self.bits.count), UInt64(self.flatChar2nodeIndices.count), UInt64(self.selectHints.count)])
+        append(self.bits)
+        append(self.rankLarge)
+        data.append(contentsOf: [UInt8](repeating: 0, count: layout.index - data.count))
+        append(self.flatChar2nodeIndicesIndex)
+        append(self.flatChar2nodeIndices)
+        append(self.selectHints)
+        return data
+    }
+
+    /// ビット列と各ノードの文字から検索用の表を構築する
+    private static func makeTables(bytes: [UInt64], nodeIndex2ID: [UInt8]) -> (flatChar2nodeIndices: [UInt32], flatChar2nodeIndicesIndex: [UInt32], rankLarge: [UInt32], selectHints: [UInt32]) {
         // flatChar2nodeIndicesIndexを構築する
         // これは、どのcharがどれだけの長さのnodeIndicesを持つかを知るために行う
-        var flatChar2nodeIndicesIndex = [Int](repeating: 0, count: 256)
+        var flatChar2nodeIndicesIndex = [UInt32](repeating: 0, count: 256)
         flatChar2nodeIndicesIndex.withUnsafeMutableBufferPointer { buffer in
             for value in nodeIndex2ID {
                 buffer[Int(value)] += 1
@@ -42,19 +221,18 @@ package struct LOUDS: Sendable {
         // flatChar2nodeIndicesを構築する
         // すでに開始位置はflatChar2nodeIndicesIndexで分かるので、もう一度countsを構築しながら適切な場所にindexを入れていく
         var counts = [Int](repeating: 0, count: 256)
-        self.flatChar2nodeIndices = counts.withUnsafeMutableBufferPointer { countsBuffer in
-            var flatChar2nodeIndices = [Int](repeating: 0, count: nodeIndex2ID.count)
+        let flatChar2nodeIndices = counts.withUnsafeMutableBufferPointer { countsBuffer in
+            var flatChar2nodeIndices = [UInt32](repeating: 0, count: nodeIndex2ID.count)
             for (i, value) in zip(nodeIndex2ID.indices, nodeIndex2ID) {
                 if value == .zero {
-                    flatChar2nodeIndices[countsBuffer[Int(value)]] = i
+                    flatChar2nodeIndices[countsBuffer[Int(value)]] = UInt32(i)
                 } else {
-                    flatChar2nodeIndices[flatChar2nodeIndicesIndex[Int(value) - 1] + countsBuffer[Int(value)]] = i
+                    flatChar2nodeIndices[Int(flatChar2nodeIndicesIndex[Int(value) - 1]) + countsBuffer[Int(value)]] = UInt32(i)
                 }
                 countsBuffer[Int(value)] += 1
             }
             return flatChar2nodeIndices
         }
-        self.flatChar2nodeIndicesIndex = flatChar2nodeIndicesIndex
 
         var rankLarge: [UInt32] = .init(repeating: 0, count: bytes.count + 1)
         rankLarge.withUnsafeMutableBufferPointer { buffer in
@@ -62,11 +240,88 @@ package struct LOUDS: Sendable {
                 buffer[i + 1] = buffer[i] &+ UInt32(Self.unit &- byte.nonzeroBitCount)
             }
         }
-        self.rankLarge = rankLarge
+
+        // (s << selectSampleShift) + 1番目の0を含むbitsのindexを順に記録する
+        var selectHints: [UInt32] = []
+        selectHints.reserveCapacity(Int(rankLarge[bytes.count]) >> Self.selectSampleShift + 2)
+        var zero: UInt32 = 1
+        for i in bytes.indices {
+            while zero <= rankLarge[i + 1] {
+                selectHints.append(UInt32(i))
+                zero += 1 << Self.selectSampleShift
+            }
+        }
+        selectHints.append(UInt32(max(bytes.count - 1, 0)))
+        return (flatChar2nodeIndices, flatChar2nodeIndicesIndex, rankLarge, selectHints)
+    }
+
+    /// `word`の上位ビットから数えて`rank`番目（1始まり）の0の位置を返す
+    ///
+    /// バイトごとの0の数の累積和を1語の中で並列に計算し、目的の0を含むバイトを分岐なしで特定する。
+    /// バイト内の位置は`selectInByte`を引いて求める。
+    @inline(__always) private static func selectZero(in word: Unit, rank: Int) -> Int {
+        let ones: Unit = 0x0101_0101_0101_0101
+        let highs: Unit = 0x8080_8080_8080_8080
+        let x = ~word
+        // 各バイトに、そのバイトに含まれる1の数を入れる
+        var counts = x &- ((x >> 1) & 0x5555_5555_5555_5555)
+        counts = (counts & 0x3333_3333_3333_3333) &+ ((counts >> 2) & 0x3333_3333_3333_3333)
+        counts = (counts &+ (counts >> 4)) & 0x0F0F_0F0F_0F0F_0F0F
+        // 上位バイトからの累積和を下位バイトから順に並べる
+        let prefix = counts.byteSwapped &* ones
+        // 累積和がrank以上のバイトに最上位ビットを立て、rank未満のバイトの数を数える
+        let reached = ((prefix | highs) &- Unit(truncatingIfNeeded: rank) &* ones) & highs
+        let byteIndex = 8 &- reached.nonzeroBitCount
+        let before = byteIndex == 0 ? 0 : Int(truncatingIfNeeded: (prefix >> ((byteIndex &- 1) << 3)) & 0xFF)
+        let byte = Int(truncatingIfNeeded: (x >> (56 &- (byteIndex << 3))) & 0xFF)
+        return (byteIndex << 3) &+ Int(Self.selectInByte[(byte << 3) | (rank &- before &- 1)])
+    }
+
+    /// `selectInByte[(byte << 3) | r]`は、`byte`の上位ビットから数えて`r + 1`番目の1の位置
+    private static let selectInByte: [UInt8] = (0 ..< 256).flatMap { (byte: Int) -> [UInt8] in
+        var positions = (0 ..< 8).filter { byte & (0x80 >> $0) != 0 }.map { UInt8($0) }
+        positions.append(contentsOf: repeatElement(0, count: 8 - positions.count))
+        return positions
+    }
+
+    /// `zero`番目（1始まり）の0の、ビット列全体での位置を返す
+    ///
+    /// `selectHints`で`rankLarge`の探索範囲を標本の間に絞り込むため、探索は定数回で終わる。
+    @inline(__always) private func selectZero(_ zero: Int) -> Int {
+        let sample = (zero &- 1) >> Self.selectSampleShift
+        // rankLarge[left] < zero <= rankLarge[right + 1]を保って、左側の0がzero個未満となる最大のindexを探す
+        var left = Int(self.selectHints[sample])
+        var right = Int(self.selectHints[sample &+ 1])
+        while left < right {
+            let mid = (left &+ right &+ 1) >> 1
+            if self.rankLarge[mid] < zero {
+                left = mid
+            } else {
+                right = mid &- 1
+            }
+        }
+        return (left << Self.uExp) &+ Self.selectZero(in: self.bits[left], rank: zero &- Int(self.rankLarge[left]))
     }
 
     /// parentNodeIndex個の0を探索し、その次から1個増えるまでのIndexを返す。
-    @inlinable func childNodeIndices(from parentNodeIndex: Int) -> Range<Int> {
+    package func childNodeIndices(from parentNodeIndex: Int) -> Range<Int> {
+        // parentNodeIndex番目の0とparentNodeIndex+1番目の0の間に並ぶ1が子ノードを表す。
+        // 位置pの1に対応するノードの番号は、左側の0の数を引いたp - parentNodeIndex + 1になる。
+        let zeroCount = Int(self.rankLarge[self.rankLarge.endIndex &- 1])
+        guard 1 <= parentNodeIndex && parentNodeIndex <= zeroCount else {
+            return 0 ..< 0
+        }
+        let start = self.selectZero(parentNodeIndex) &- parentNodeIndex &+ 2
+        guard parentNodeIndex < zeroCount else {
+            return start ..< start
+        }
+        return start ..< self.selectZero(parentNodeIndex &+ 1) &- parentNodeIndex &+ 1
+    }
+
+    /// `childNodeIndices(from:)`と同じ結果を、`selectHints`を使わずに`rankLarge`の二分探索とビット走査で求める
+    ///
+    /// select索引の導入前の実装で、ベンチマークとテストで比較するために残している。
+    package func childNodeIndicesByBinarySearch(from parentNodeIndex: Int) -> Range<Int> {
         // 求めるのは、
         // startIndex == 自身の左側にparentNodeIndex個の0があるような最小のindex
         // endIndex == 自身の左側にparentNodeIndex+1個の0があるような最小のindex
@@ -91,34 +346,33 @@ package struct LOUDS: Sendable {
             return 0 ..< 0
         }
         let i = left - 1
-        return self.bits.withUnsafeBufferPointer {(buffer: UnsafeBufferPointer<Unit>) -> Range<Int> in
-            // 探索パート②
-            // 目標はparentNodeIndex番目の0の位置である`k`の発見
-            let byte = buffer[i]
-            var k = 0
-            for _ in  0 ..< parentNodeIndex - Int(self.rankLarge[i]) {
-                k = (~(byte << k)).leadingZeroBitCount &+ k &+ 1
-            }
-            let start = (i << Self.uExp) &+ k &- parentNodeIndex &+ 1
-            // ちょうどparentNodeIndex個の0がi番目にあるかどうか
-            if self.rankLarge[i &+ 1] == parentNodeIndex {
-                var j = i &+ 1
-                while buffer[j] == Unit.max {
-                    j &+= 1
-                }
-                // 最初の0を探す作業
-                // 反転して、先頭から0の数を数えると最初の0の位置が出てくる
-                // Ex. 1110_0000 => [000]1_1111 => 3
-                let byte2 = buffer[j]
-                let a = (~byte2).leadingZeroBitCount % Self.unit
-                return start ..< (j << Self.uExp) &+ a &- parentNodeIndex &+ 1
-            } else {
-                // difが0以上の場合、k番目以降の初めての0を発見したい
-                // 例えばk=1の場合
-                // Ex. 1011_1101 => 0111_1010 => 1000_0101 => 1 => 2
-                let a = ((~(byte << k)).leadingZeroBitCount &+ k) % Self.unit
-                return start ..< (i << Self.uExp) &+ a &- parentNodeIndex &+ 1
+        let buffer = self.bits
+        // 探索パート②
+        // 目標はparentNodeIndex番目の0の位置である`k`の発見
+        let byte = buffer[i]
+        var k = 0
+        for _ in  0 ..< parentNodeIndex - Int(self.rankLarge[i]) {
+            k = (~(byte << k)).leadingZeroBitCount &+ k &+ 1
+        }
+        let start = (i << Self.uExp) &+ k &- parentNodeIndex &+ 1
+        // ちょうどparentNodeIndex個の0がi番目にあるかどうか
+        if self.rankLarge[i &+ 1] == parentNodeIndex {
+            var j = i &+ 1
+            while buffer[j] == Unit.max {
+                j &+= 1
             }
+            // 最初の0を探す作業
+            // 反転して、先頭から0の数を数えると最初の0の位置が出てくる
+            // Ex. 1110_0000 => [000]1_1111 => 3
+            let byte2 = buffer[j]
+            let a = (~byte2).leadingZeroBitCount % Self.unit
+            return start ..< (j << Self.uExp) &+ a &- parentNodeIndex &+ 1
+        } else {
+            // difが0以上の場合、k番目以降の初めての0を発見したい
+            // 例えばk=1の場合
+            // Ex. 1011_1101 => 0111_1010 => 1000_0101 => 1 => 2
+            let a = ((~(byte << k)).leadingZeroBitCount &+ k) % Self.unit
+            return start ..< (i << Self.uExp) &+ a &- parentNodeIndex &+ 1
         }
     }
 
@@ -127,24 +381,20 @@ package struct LOUDS: Sendable {
     @inlinable func searchCharNodeIndex(from parentNodeIndex: Int, char: UInt8) -> Int? {
         // char2nodeIndicesには単調増加性があるので二分探索が成立する
         let childNodeIndices = self.childNodeIndices(from: parentNodeIndex)
-        let nodeIndices: ArraySlice<Int> = if char == .zero {
-            self.flatChar2nodeIndices[0 ..< self.flatChar2nodeIndicesIndex[Int(char)]]
-        } else {
-            self.flatChar2nodeIndices[self.flatChar2nodeIndicesIndex[Int(char - 1)] ..< self.flatChar2nodeIndicesIndex[Int(char)]]
-        }
-
-        var left = nodeIndices.startIndex
-        var right = nodeIndices.endIndex
+        let nodeIndices = self.flatChar2nodeIndices
+        let endIndex = Int(self.flatChar2nodeIndicesIndex[Int(char)])
+        var left = char == .zero ? 0 : Int(self.flatChar2nodeIndicesIndex[Int(char - 1)])
+        var right = endIndex
         while left < right {
             let mid = (left + right) >> 1
-            if childNodeIndices.startIndex <= nodeIndices[mid] {
+            if childNodeIndices.startIndex <= Int(nodeIndices[mid]) {
                 right = mid
             } else {
                 left = mid + 1
             }
         }
-        if left < nodeIndices.endIndex && childNodeIndices.contains(nodeIndices[left]) {
-            return nodeIndices[left]
+        if left < endIndex && childNodeIndices.contains(Int(nodeIndices[left])) {
+            return Int(nodeIndices[left])
         } else {
             return nil
         }
@@ -0,0 +1,139 @@
+import Foundation
+
+/// `loudstxt3`から読み出して`DicdataElement`に変換済みのエントリを、ノードごとに保持するLRUキャッシュ
+///
+/// 同じ読みの前方部分を何度も打鍵する場合に、ファイルの再読み込みとUTF-8のデコードを避けるために用いる。
+/// 複数の`KanaKanjiConverter`から共有されるため、内部でロックを取る。
+final class LoudstxtEntryCache: @unchecked Sendable {
+    struct Key: Hashable {
+        /// エスケープ済みの辞書の識別子
+        var identifier: String
+        /// LOUDS上のノード番号（シャード番号とシャード内の位置を合わせたもの）
+        var nodeIndex: Int
+    }
+
+    /// 双方向リストのノード。`slots`上の位置を`prev`と`next`で指す
+    private struct Slot {
+        var key: Key
+        var value: [DicdataElement]
+        var prev: Int
+        var next: Int
+    }
+
+    init(capacity: Int) {
+        self.capacity = max(capacity, 1)
+    }
+
+    /// 保持するノード数の上限
+    let capacity: Int
+
+    private let lock = NSLock()
+    private var slotIndices: [Key: Int] = [:]
+    private var slots: [Slot] = []
+    /// 最も最近使われたスロット
+    private var head = -1
+    /// 最も長く使われていないスロット
+    private var tail = -1
+    private var hits = 0
+    private var misses = 0
+
+    /// キャッシュされたエントリを返し、最近使われたものとして扱う
+    func value(for key: Key) -> [DicdataElement]? {
+        self.lock.withLock {
+            guard let index = self.slotIndices[key] else {
+                self.misses += 1
+                return nil
+            }
+            self.hits += 1
+            self.moveToHead(index)
+            return self.slots[index].value
+        }
+    }
+
+    /// エントリを追加する。上限を超える場合は最も長く使われていないものを捨てる
+    func insert(_ value: [DicdataElement], for key: Key) {
+        self.lock.withLock {
+            if let index = self.slotIndices[key] {
+                self.slots[index].value = value
+                self.moveToHead(index)
+                return
+            }
+            let index: Int
+            if self.slots.count < self.capacity {
+                index = self.slots.count
+                self.slots.append(Slot(key: key, value: value, prev: -1, next: -1))
+            } else {
+                // 末尾のスロットを再利用する
+                index = self.tail
+                self.unlink(index)
+                self.slotIndices.removeValue(forKey: self.slots[index].key)
+                self.slots[index].key = key
+                self.slots[index].value = value
+            }
+            self.slotIndices[key] = index
+            self.linkAtHead(index)
+        }
+    }
+
+    /// これまでのヒット数とミス数、現在保持しているノード数
+    var statistics: (hits: Int, misses: Int, count: Int) {
+        self.lock.withLock {
+            (self.hits, self.misses, self.slotIndices.count)
+        }
+    }
+
+    /// ヒット数とミス数を0に戻す
+    func resetStatistics() {
+        self.lock.withLock {
+            self.hits = 0
+            self.misses = 0
+        }
+    }
+
+    /// 全てのエントリと統計を破棄する
+    func removeAll() {
+        self.lock.withLock {
+            self.slotIndices.removeAll()
+            self.slots.removeAll()
+            self.head = -1
+            self.tail = -1
+            self.hits = 0
+            self.misses = 0
+        }
+    }
+
+    private func moveToHead(_ index: Int) {
+        guard index != self.head else {
+            return
+        }
+        self.unlink(index)
+        self.linkAtHead(index)
+    }
+
+    private func unlink(_ index: Int) {
+        let (prev, next) = (self.slots[index].prev, self.slots[index].next)
+        if prev >= 0 {
+            self.slots[prev].next = next
+        } else {
+            self.head = next
+        }
+        if next >= 0 {
+            self.slots[next].prev = prev
+        } else {
+            self.tail = prev
+        }
+        self.slots[index].prev = -1
+        self.slots[index].next = -1
+    }
+
+    private func linkAtHead(_ index: Int) {
+        self.slots[index].next = self.head
+        if self.head >= 0 {
+            self.slots[self.head].prev = index
+        }
+        self.head = index
+        if self.tail < 0 {
+            self.tail = index
+        }
+    }
+}
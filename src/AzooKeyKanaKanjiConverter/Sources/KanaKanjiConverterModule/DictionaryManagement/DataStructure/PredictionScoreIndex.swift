@@ -0,0 +1,165 @@
+import Collections
+import Foundation
+
+/// LOUDSの各ノードについて、予測変換に用いることのできるエントリのスコアの最大値を記録した表
+///
+/// `DictionaryBuilder`が`.loudsx`とあわせて書き出す`<identifier>.loudsmax`をメモリマップして用いる。
+/// ノードごとに「そのノード自身のエントリの最大値」と「子孫を含めたエントリの最大値」を持つため、
+/// 前方一致検索の際にスコアの高い部分木から順に辿り、上位のノードだけを取り出すことができる。
+final class PredictionScoreIndex: @unchecked Sendable {
+    /// ファイルの拡張子
+    static let fileExtension = "loudsmax"
+    /// ファイルの先頭に置かれる識別子
+    private static let magic: [UInt8] = Array("LOUDSMX1".utf8)
+    /// ヘッダのバイト数（識別子、ノード数）
+    private static let headerSize = 16
+    /// 予測変換に用いるエントリを持たないノードの値
+    static let none: Float32 = -.infinity
+
+    private init(mapping: NSData, nodeCount: Int, ownScores: UnsafeBufferPointer<Float32>, subtreeScores: UnsafeBufferPointer<Float32>) {
+        self.mapping = mapping
+        self.nodeCount = nodeCount
+        self.ownScores = ownScores
+        self.subtreeScores = subtreeScores
+    }
+
+    /// 領域を所有するデータ。`ownScores`と`subtreeScores`はこの領域内を指す
+    private let mapping: NSData
+    /// ノード数。対応するLOUDSのノード数と一致する
+    let nodeCount: Int
+    /// ノード自身のエントリのスコアの最大値
+    private let ownScores: UnsafeBufferPointer<Float32>
+    /// ノードとその子孫のエントリのスコアの最大値
+    private let subtreeScores: UnsafeBufferPointer<Float32>
+
+    /// メモリマップした`.loudsmax`ファイルの内容から表を構築する
+    /// - Parameter mapping: ファイルの内容
+    /// - Returns: 形式が不正な場合は`nil`を返す。
+    convenience init?(mapping: NSData) {
+        #if _endian(big)
+        // ファイルはリトルエンディアンで記録されている
+        return nil
+        #else
+        let base = mapping.bytes
+        let length = mapping.length
+        guard length >= Self.headerSize,
+              Int(bitPattern: base) % MemoryLayout<Float32>.alignment == 0,
+              Self.magic.indices.allSatisfy({ base.load(fromByteOffset: $0, as: UInt8.self) == Self.magic[$0] }) else {
+            return nil
+        }
+        let nodeCount = Int(truncatingIfNeeded: base.load(fromByteOffset: 8, as: UInt64.self))
+        guard (0 ... length / MemoryLayout<Float32>.size).contains(nodeCount),
+              length == Self.headerSize + 2 * nodeCount * MemoryLayout<Float32>.size else {
+            return nil
+        }
+        let scores = (base + Self.headerSize).assumingMemoryBound(to: Float32.self)
+        self.init(
+            mapping: mapping,
+            nodeCount: nodeCount,
+            ownScores: UnsafeBufferPointer(start: scores, count: nodeCount),
+            subtreeScores: UnsafeBufferPointer(start: scores + nodeCount, count: nodeCount)
+        )
+        #endif
+    }
+
+    /// `dictionaryURL`以下の`louds/<identifier>.loudsmax`をメモリマップして読み込む
+    /// - Returns: ファイルが存在しない場合や、形式が不正な場合は`nil`を返す。
+    static func load(_ identifier: String, dictionaryURL: URL) -> PredictionScoreIndex? {
+        let url = dictionaryURL.appendingPathComponent("louds/\(identifier).\(Self.fileExtension)", isDirectory: false)
+        guard FileManager.default.fileExists(atPath: url.path) else {
+            return nil
+        }
+        do {
+            FileAccessCounter.recordOpen()
+            let mapping = try NSData(contentsOf: url, options: [.alwaysMapped])
+            guard let index = PredictionScoreIndex(mapping: mapping) else {
+                debug("Error: \(url)の形式が不正です。予測変換ではスコアを用いずに探索します。")
+                return nil
+            }
+            return index
+        } catch {
+            debug(#function, error)
+            return nil
+        }
+    }
+
+    private struct Item: Comparable {
+        /// 文字数に応じたペナルティを加えたスコア。部分木の場合はその上限
+        var key: Float32
+        var nodeIndex: Int
+        /// 前方一致の起点からの文字数
+        var depth: Int
+        /// `true`ならノード自身を結果とし、`false`なら子ノードを展開する
+        var isEntry: Bool
+
+        static func < (lhs: Self, rhs: Self) -> Bool {
+            if lhs.key != rhs.key {
+                return lhs.key < rhs.key
+            }
+            // 同点の場合はノード番号の小さいものを優先する
+            return lhs.nodeIndex > rhs.nodeIndex
+        }
+    }
+
+    /// `nodeIndex`の子孫のうち、予測変換に用いるエントリのスコアが高いノードを最大`maxCount`件返す
+    ///
+    /// 子孫のスコアの最大値を上限として優先度付きキューで辿るため、返すのは条件を満たすノードの中で上位のものになる。
+    /// `LOUDS.prefixNodeIndices(nodeIndex:maxDepth:maxCount:)`と同様に、`nodeIndex`自身は含まず、`maxDepth + 1`文字先までを対象とする。
+    /// - Parameters:
+    ///   - depthPenalty: 1文字先に進むごとにスコアから引く値
+    /// - Returns: スコアの高い順に並んだノード番号
+    func bestNodeIndices(louds: LOUDS, from nodeIndex: Int, maxDepth: Int, maxCount: Int, depthPenalty: Float32) -> [Int] {
+        var result: [Int] = []
+        result.reserveCapacity(min(maxCount, 256))
+        var heap = Heap<Item>()
+        func pushChildren(of nodeIndex: Int, depth: Int) {
+            for child in louds.childNodeIndices(from: nodeIndex) where child < self.nodeCount {
+                let score = self.subtreeScores[child]
+                if score != Self.none {
+                    heap.insert(Item(key: score - Float32(depth) * depthPenalty, nodeIndex: child, depth: depth, isEntry: false))
+                }
+            }
+        }
+        pushChildren(of: nodeIndex, depth: 1)
+        while result.count < maxCount, let item = heap.popMax() {
+            if item.isEntry {
+                result.append(item.nodeIndex)
+                continue
+            }
+            let own = self.ownScores[item.nodeIndex]
+            if own != Self.none {
+                heap.insert(Item(key: own - Float32(item.depth) * depthPenalty, nodeIndex: item.nodeIndex, depth: item.depth, isEntry: true))
+            }
+            if item.depth <= maxDepth {
+                pushChildren(of: item.nodeIndex, depth: item.depth + 1)
+            }
+        }
+        return result
+    }
+
+    /// `.loudsmax`形式のバイナリを生成する
+    /// - Parameters:
+    ///   - louds: 対象のLOUDS
+    ///   - ownScores: ノード番号と、そのノードの予測変換に用いるエントリのスコアの最大値
+    static func fileData(louds: LOUDS, ownScores: [Int: Float32]) -> Data {
+        let nodeCount = louds.nodeCount
+        var own = [Float32](repeating: Self.none, count: nodeCount)
+        for (nodeIndex, score) in ownScores where own.indices.contains(nodeIndex) {
+            own[nodeIndex] = score
+        }
+        // 子ノードの番号は親ノードより大きいため、後ろから親に伝播させる
+        var subtree = own
+        for nodeIndex in (1 ..< max(nodeCount, 1)).reversed() {
+            for child in louds.childNodeIndices(from: nodeIndex) where child < nodeCount {
+                subtree[nodeIndex] = max(subtree[nodeIndex], subtree[child])
+            }
+        }
+        var data = Data(capacity: Self.headerSize + 2 * nodeCount * MemoryLayout<Float32>.size)
+        data.append(contentsOf: Self.magic)
+        withUnsafeBytes(of: UInt64(nodeCount).littleEndian) { data.append(contentsOf: $0) }
+        for value in own + subtree {
+            withUnsafeBytes(of: value.bitPattern.littleEndian) { data.append(contentsOf: $0) }
+        }
+        return data
+    }
+}
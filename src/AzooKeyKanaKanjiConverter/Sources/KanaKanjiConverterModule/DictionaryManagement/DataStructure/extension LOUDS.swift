@@ -38,6 +38,7 @@ extension LOUDS {
     }
     private static func loadLOUDSBinary(from url: URL) -> [UInt64]? {
         do {
+            FileAccessCounter.recordOpen()
             let binaryData = try Data(contentsOf: url, options: [.uncached, .mappedIfSafe]) // 2度読み込むことはないのでキャッシュ不要
             return binaryData.toArray(of: UInt64.self)
         } catch {
@@ -46,10 +47,37 @@ extension LOUDS {
         }
     }
 
+    /// `.loudsx`ファイルをメモリマップして読み込む
+    ///
+    /// 検索用の表はファイルに格納済みのため、読み込みはファイルサイズによらず定数時間で終わる。
+    /// マップした領域はプロセス間でページを共有できる。
+    private static func loadMapped(from url: URL) -> LOUDS? {
+        guard FileManager.default.fileExists(atPath: url.path) else {
+            return nil
+        }
+        do {
+            FileAccessCounter.recordOpen()
+            let mapping = try NSData(contentsOf: url, options: [.alwaysMapped])
+            guard let louds = LOUDS(mapping: mapping) else {
+                debug("Error: \(url)の形式が不正です。`.louds`から読み込みます。")
+                return nil
+            }
+            return louds
+        } catch {
+            debug(#function, error)
+            return nil
+        }
+    }
+
     /// LOUDSをファイルから読み込む関数
+    ///
+    /// `.loudsx`ファイルがあればそれをメモリマップして利用し、なければ`.louds`と`.loudschars2`から構築する。
     /// - Parameter identifier: ファイル名
     /// - Returns: 存在すればLOUDSデータを返し、存在しなければ`nil`を返す。
     package static func load(_ identifier: String, dictionaryURL: URL) -> LOUDS? {
+        if let louds = loadMapped(from: dictionaryURL.appendingPathComponent("louds/\(identifier).loudsx", isDirectory: false)) {
+            return louds
+        }
         let (charsURL, loudsURL) = (
             dictionaryURL.appendingPathComponent("louds/\(identifier).loudschars2", isDirectory: false),
             dictionaryURL.appendingPathComponent("louds/\(identifier).louds", isDirectory: false)
@@ -84,6 +112,7 @@ extension LOUDS {
     private static func load(charsURL: URL, loudsURL: URL) -> LOUDS? {
         let nodeIndex2ID: [UInt8]
         do {
+            FileAccessCounter.recordOpen()
             nodeIndex2ID = try Array(Data(contentsOf: charsURL, options: [.uncached]))   // 2度読み込むことはないのでキャッシュ不要
         } catch {
             debug("Error: \(loudsURL)に対するLOUDSファイルが存在しません。このエラーは無視できる可能性があります。 Description: \(error)")
@@ -166,6 +195,7 @@ extension LOUDS {
         }
         do {
             let url = userDictionaryURL.appendingPathComponent("\(identifier).loudstxt3", isDirectory: false)
+            FileAccessCounter.recordOpen()
             return Self.parseLoudstxt3Binary(binary: try Data(contentsOf: url), indices: indices)
         } catch {
             debug(#function, error)
@@ -179,6 +209,7 @@ extension LOUDS {
         }
         do {
             let url = userDictionaryURL.appendingPathComponent("\(identifier).loudstxt3", isDirectory: false)
+            FileAccessCounter.recordOpen()
             return Self.parseLoudstxt3Binary(binary: try Data(contentsOf: url), indices: indices)
         } catch {
             debug(#function, error)
@@ -192,6 +223,7 @@ extension LOUDS {
         }
         do {
             let url = memoryURL.appendingPathComponent("\(identifier).loudstxt3", isDirectory: false)
+            FileAccessCounter.recordOpen()
             return Self.parseLoudstxt3Binary(binary: try Data(contentsOf: url), indices: indices)
         } catch {
             debug(#function, error)
@@ -205,6 +237,7 @@ extension LOUDS {
         }
         do {
             let url = dictionaryURL.appendingPathComponent("louds/\(identifier).loudstxt3", isDirectory: false)
+            FileAccessCounter.recordOpen()
             return Self.parseLoudstxt3Binary(binary: try Data(contentsOf: url, options: [.mappedIfSafe]), indices: indices)
         } catch {
             debug(#function, error)
@@ -212,19 +245,49 @@ extension LOUDS {
         }
     }
 
-    private static func parseLoudstxt3Binary(binary: borrowing Data, indices: [Int]) -> [DicdataElement] {
+    /// `getDataForLoudstxt3`と同じファイルを読み、結果を`indices`の各要素ごとに分けて返す
+    ///
+    /// ノード単位でキャッシュするために用いる。
+    static func getEntriesForLoudstxt3(_ identifier: String, indices: [Int], cache: Data? = nil, dictionaryURL: URL) -> [[DicdataElement]] {
+        if let cache {
+            return indices.map { Self.parseLoudstxt3Entry(binary: cache, index: $0) }
+        }
+        do {
+            let url = dictionaryURL.appendingPathComponent("louds/\(identifier).loudstxt3", isDirectory: false)
+            FileAccessCounter.recordOpen()
+            let binary = try Data(contentsOf: url, options: [.mappedIfSafe])
+            return indices.map { Self.parseLoudstxt3Entry(binary: binary, index: $0) }
+        } catch {
+            debug(#function, error)
+            return indices.map { _ in [] }
+        }
+    }
+
+    private static func parseLoudstxt3Entry(binary: borrowing Data, index idx: Int) -> [DicdataElement] {
         let lc: Int = Int(readUInt16LE(binary, 0))
         // Header table of UInt32 offsets starts at byte 2
+        let start = Int(readUInt32LE(binary, 2 + idx * 4))
+        let end: Int = if idx == (lc - 1) {
+            binary.endIndex
+        } else {
+            Int(readUInt32LE(binary, 2 + (idx + 1) * 4))
+        }
+        return parseBinary(binary: binary[start ..< end])
+    }
+
+    /// `loudstxt3`ファイルに含まれる全てのノードのエントリを読み出す
+    static func parseAllLoudstxt3Entries(binary: borrowing Data) -> [DicdataElement] {
+        guard binary.count >= 2 else {
+            return []
+        }
+        return Self.parseLoudstxt3Binary(binary: binary, indices: Array(0 ..< Int(readUInt16LE(binary, 0))))
+    }
+
+    private static func parseLoudstxt3Binary(binary: borrowing Data, indices: [Int]) -> [DicdataElement] {
         var out: [DicdataElement] = []
         out.reserveCapacity(indices.count * 2) // rough guess
         for idx in indices {
-            let start = Int(readUInt32LE(binary, 2 + idx * 4))
-            let end: Int = if idx == (lc - 1) {
-                binary.endIndex
-            } else {
-                Int(readUInt32LE(binary, 2 + (idx + 1) * 4))
-            }
-            out.append(contentsOf: parseBinary(binary: binary[start ..< end]))
+            out.append(contentsOf: parseLoudstxt3Entry(binary: binary, index: idx))
         }
         return out
     }
@@ -16,14 +16,44 @@ public final class DicdataStore {
         self.setup(preloadDictionary: preloadDictionary)
     }
 
-    private var ccParsed: [Bool] = .init(repeating: false, count: 1319)
-    private var ccLines: [Int: [PValue]] = [:]
+    deinit {
+        for line in self.ccLines {
+            line?.deallocate()
+        }
+        self.ccLines.deallocate()
+    }
+
+    /// 読み込んだ連接確率の行を`former`ごとに並べた表。未読み込みの行は`nil`。`cacheLock`で保護する
+    ///
+    /// 一度書き込んだ行は解放まで書き換えないため、取得した行へのポインタは`DicdataStore`が解放されるまで有効である。
+    private let ccLines: UnsafeMutableBufferPointer<UnsafeMutablePointer<PValue>?> = {
+        let table = UnsafeMutableBufferPointer<UnsafeMutablePointer<PValue>?>.allocate(capacity: 1319)
+        table.initialize(repeating: nil)
+        return table
+    }()
+    /// `cb/matrix.ccm`が存在する場合にメモリマップした連接確率の行列。存在する場合は`ccLines`の代わりに用いる
+    private var ccMatrix: ConnectionCostMatrix?
     private var mmValue: [PValue] = []
 
     private var loudses: [String: LOUDS] = [:]
     private var loudstxts: [String: Data] = [:]
+    /// 共有辞書の`loudstxt3`から読み出したエントリをノード単位で保持するキャッシュ
+    private let loudstxtEntryCache = LoudstxtEntryCache(capacity: 4096)
     private var importedLoudses: Set<String> = []
+    /// `DictionaryBuilder.exportUnifiedDictionary`で書き出された、全ての読みを1つにまとめたLOUDS
+    ///
+    /// 存在する場合は先頭文字ごとのLOUDSの代わりに常にこれを用いる。
+    private var unifiedLOUDS: LOUDS?
+    /// 共有辞書のLOUDSごとの予測変換用のスコアの表。ファイルが存在しない場合は`nil`を記録する
+    private var predictionScoreIndices: [String: PredictionScoreIndex?] = [:]
     private var charsID: [Character: UInt8] = [:]
+    /// 複数の`KanaKanjiConverter`から共有された場合に、遅延読み込みするキャッシュ(`loudses`、`ccLines`への読み込みなど)を保護するロック
+    private let cacheLock = NSLock()
+    /// ユーザ辞書のディレクトリごとに共有するコンパイラ。`userDictionaryCompilersLock`で保護する
+    ///
+    /// 同じディレクトリを指す`KanaKanjiConverter`の間で差分を共有し、統合が同時に走らないようにする。
+    private var userDictionaryCompilers: [URL: UserDictionaryCompiler] = [:]
+    private let userDictionaryCompilersLock = NSLock()
 
     /// 辞書のエントリの最大長さ
     ///  - TODO: make this value as an option
@@ -36,21 +66,34 @@ public final class DicdataStore {
 
     private let dictionaryURL: URL
 
+    /// 漢数字を作る`NumberFormatter`。スレッドセーフではなく、並列の辞書引きから呼ばれるため`numberFormatterLock`の内側で用いる
     private let numberFormatter = NumberFormatter()
+    private let numberFormatterLock = NSLock()
     /// 初期化時のセットアップ用の関数。プロパティリストを読み込み、連接確率リストを読み込んで行分割し保存しておく。
     private func setup(preloadDictionary: Bool) {
         numberFormatter.numberStyle = .spellOut
         numberFormatter.locale = .init(identifier: "ja-JP")
 
         do {
+            FileAccessCounter.recordOpen()
             let string = try String(contentsOf: self.dictionaryURL.appendingPathComponent("louds/charID.chid", isDirectory: false), encoding: String.Encoding.utf8)
             charsID = [Character: UInt8].init(uniqueKeysWithValues: string.enumerated().map {($0.element, UInt8($0.offset))})
         } catch {
             debug("Error: louds/charID.chidが存在しません。このエラーは深刻ですが、テスト時には無視できる場合があります。Description: \(error)")
         }
+        let unifiedIdentifier = DictionaryBuilder.unifiedIdentifier
+        if ["loudsx", "louds"].contains(where: {
+            FileManager.default.fileExists(atPath: self.dictionaryURL.appendingPathComponent("louds/\(unifiedIdentifier).\($0)", isDirectory: false).path)
+        }) {
+            self.unifiedLOUDS = LOUDS.load(unifiedIdentifier, dictionaryURL: self.dictionaryURL)
+        }
+        if let ccMatrix = ConnectionCostMatrix.load(dictionaryURL: self.dictionaryURL), ccMatrix.rowCount == self.cidCount {
+            self.ccMatrix = ccMatrix
+        }
         do {
             let url = self.dictionaryURL.appendingPathComponent("mm.binary", isDirectory: false)
             do {
+                FileAccessCounter.recordOpen()
                 let binaryData = try Data(contentsOf: url, options: [.uncached])
                 self.mmValue = binaryData.toArray(of: Float.self).map {PValue($0)}
             } catch {
@@ -82,6 +125,7 @@ public final class DicdataStore {
                 }
                 loudses[identifier] = LOUDS.load(identifier, dictionaryURL: self.dictionaryURL)
             case "loudstxt3":
+                FileAccessCounter.recordOpen()
                 if let data = try? Data(contentsOf: url) {
                     loudstxts[identifier] = data
                 } else {
@@ -101,14 +145,25 @@ public final class DicdataStore {
         self.charsID[character, default: .max]
     }
 
+    /// 読みの先頭文字に対応する辞書の識別子を返す
+    ///
+    /// 統合されたLOUDSがある場合は先頭文字によらず`DictionaryBuilder.unifiedIdentifier`を返す。
+    private func sharedDictionaryIdentifier(firstCharacter: Character) -> String {
+        self.unifiedLOUDS == nil ? String(firstCharacter) : DictionaryBuilder.unifiedIdentifier
+    }
+
     private func reloadMemory() {
-        self.loudses.removeValue(forKey: "memory")
-        self.importedLoudses.remove("memory")
+        self.cacheLock.withLock {
+            self.loudses.removeValue(forKey: "memory")
+            self.importedLoudses.remove("memory")
+        }
     }
 
     private func reloadUser() {
-        self.loudses.removeValue(forKey: "user")
-        self.importedLoudses.remove("user")
+        self.cacheLock.withLock {
+            self.loudses.removeValue(forKey: "user")
+            self.importedLoudses.remove("user")
+        }
     }
 
     /// ペナルティ関数。文字数で決める。
@@ -117,7 +172,7 @@ public final class DicdataStore {
     }
 
     /// 計算時に利用。無視すべきデータかどうか。
-    private func shouldBeRemoved(value: PValue, wordCount: Int) -> Bool {
+    func shouldBeRemoved(value: PValue, wordCount: Int) -> Bool {
         let d = value - self.threshold
         if d < 0 {
             return true
@@ -137,16 +192,12 @@ public final class DicdataStore {
 
     func loadLOUDS(query: String, state: DicdataStoreState) -> LOUDS? {
         if query == "user" {
-            if state.userDictionaryHasLoaded {
-                return state.userDictionaryLOUDS
-            } else if let userDictionaryURL = state.userDictionaryURL,
-                      let louds = LOUDS.loadUserDictionary(userDictionaryURL: userDictionaryURL) {
-                state.updateUserDictionaryLOUDS(louds)
-                return louds
-            } else {
-                state.updateUserDictionaryLOUDS(nil)
-                debug("Error: ユーザ辞書のloudsファイルの読み込みに失敗しましたが、このエラーは深刻ではありません。")
+            // ユーザ辞書がない場合は状態を書き換えない（並列の辞書引きから呼ばれるため）
+            guard state.userDictionaryURL != nil else {
+                return nil
             }
+            let snapshot = state.userDictionarySnapshot ?? state.refreshUserDictionarySnapshot(in: self)
+            return snapshot?.louds
         }
         if query == "user_shortcuts" {
             if state.userShortcutsHasLoaded {
@@ -173,25 +224,58 @@ public final class DicdataStore {
             }
         }
 
-        if self.importedLoudses.contains(query) {
-            return self.loudses[query]
+        return self.loadSharedLOUDS(query: query)
+    }
+
+    /// ユーザ辞書・学習データ以外の、全ての`KanaKanjiConverter`で共有されるLOUDS辞書を読み込む。読み込んだ結果はキャッシュされる。
+    private func loadSharedLOUDS(query: String) -> LOUDS? {
+        if let unifiedLOUDS {
+            return unifiedLOUDS
         }
+        return self.cacheLock.withLock {
+            if self.importedLoudses.contains(query) {
+                return self.loudses[query]
+            }
 
-        // 一部のASCII文字は共通のエスケープ関数で処理する
-        let identifier = DictionaryBuilder.escapedIdentifier(query)
+            // 一部のASCII文字は共通のエスケープ関数で処理する
+            let identifier = DictionaryBuilder.escapedIdentifier(query)
 
-        if let louds = LOUDS.load(identifier, dictionaryURL: self.dictionaryURL) {
-            self.loudses[query] = louds
-            self.importedLoudses.insert(query)
-            return louds
-        } else {
-            // このケースでもinsertは行う
-            self.importedLoudses.insert(query)
-            debug("Error: IDが「\(identifier) (query: \(query))」のloudsファイルの読み込みに失敗しました。IDに対する辞書データが存在しないことが想定される場合はこのエラーは深刻ではありませんが、そうでない場合は深刻なエラーの可能性があります。")
-            return nil
+            if let louds = LOUDS.load(identifier, dictionaryURL: self.dictionaryURL) {
+                self.loudses[query] = louds
+                self.importedLoudses.insert(query)
+                return louds
+            } else {
+                // このケースでもinsertは行う
+                self.importedLoudses.insert(query)
+                debug("Error: IDが「\(identifier) (query: \(query))」のloudsファイルの読み込みに失敗しました。IDに対する辞書データが存在しないことが想定される場合はこのエラーは深刻ではありませんが、そうでない場合は深刻なエラーの可能性があります。")
+                return nil
+            }
         }
     }
 
+    /// 共有辞書のLOUDSに対応する予測変換用のスコアの表を読み込む。読み込んだ結果はキャッシュされる。
+    private func loadPredictionScoreIndex(query: String) -> PredictionScoreIndex? {
+        let identifier = DictionaryBuilder.escapedIdentifier(self.unifiedLOUDS == nil ? query : DictionaryBuilder.unifiedIdentifier)
+        return self.cacheLock.withLock {
+            if let index = self.predictionScoreIndices[identifier] {
+                return index
+            }
+            let index = PredictionScoreIndex.load(identifier, dictionaryURL: self.dictionaryURL)
+            self.predictionScoreIndices[identifier] = .some(index)
+            return index
+        }
+    }
+
+    /// 指定したLOUDS辞書を事前に読み込んでキャッシュする関数。
+    /// 初回の変換でファイルの読み込みを待たずに済むよう、バックグラウンドから呼ぶことを想定している。
+    /// - note: `user`や`memory`など、変換器ごとの状態に依存する辞書は対象外。
+    public func preloadLOUDS(query: String) {
+        if ["user", "user_shortcuts", "memory"].contains(query) {
+            return
+        }
+        _ = self.loadSharedLOUDS(query: query)
+    }
+
     /// 完全一致検索を行う関数。
     /// - Parameters:
     ///   - query: 対象とするLOUDS辞書の識別子（通常は先頭1文字や"user"など）。
@@ -296,7 +380,7 @@ public final class DicdataStore {
         needTypoCorrection: Bool,
         state: DicdataStoreState
     ) -> (
-        stringToInfo: [[Character]: (endIndex: Lattice.LatticeIndex, penalty: PValue)],
+        stringToInfo: [String: (endIndex: Lattice.LatticeIndex, penalty: PValue)],
         indices: [(key: String, indices: [Int])],
         temporaryMemoryDicdata: [DicdataElement]
     ) {
@@ -317,7 +401,9 @@ public final class DicdataStore {
             generator.register(typoCorrectionGenerator)
         }
         var targetLOUDS: [String: LOUDS.MovingTowardPrefixSearchHelper] = [:]
-        var stringToInfo: [([Character], (endIndex: Lattice.LatticeIndex, penalty: PValue))] = []
+        // 辞書データの`ruby`と直接照合できるよう、文字列をキーにする
+        var stringToInfo: [(String, (endIndex: Lattice.LatticeIndex, penalty: PValue))] = []
+        var minCount = Int.max
         // 動的辞書（一時学習データ、動的ユーザ辞書）から取り出されたデータ
         var dynamicDicdata: [Int: [DicdataElement]] = [:]
         // ジェネレータを舐める
@@ -326,10 +412,11 @@ public final class DicdataStore {
                 continue
             }
             let charIDs = characters.map(self.character2charId(_:))
+            let sharedKey = self.sharedDictionaryIdentifier(firstCharacter: firstCharacter)
             let keys: [String] = if useMemory {
-                [String(firstCharacter), "user", "memory"]
+                [sharedKey, "user", "memory"]
             } else {
-                [String(firstCharacter), "user"]
+                [sharedKey, "user"]
             }
             var updated = false
             var availableMaxIndex = 0
@@ -346,6 +433,27 @@ public final class DicdataStore {
                     availableMaxIndex = max(availableMaxIndex, result.availableMaxIndex)
                 }
             }
+            // ユーザ辞書のうち、まだLOUDSに統合されていない差分についてはこの位置で処理する
+            if let overlay = state.userDictionarySnapshot?.overlay, !overlay.isEmpty {
+                let result = overlay.movingTowardPrefixSearch(chars: charIDs, depth: 0 ..< .max)
+                updated = updated || !(result.dicdata.isEmpty)
+                availableMaxIndex = max(availableMaxIndex, result.availableMaxIndex)
+                for (depth, dicdata) in result.dicdata {
+                    for data in dicdata {
+                        if info.penalty.isZero {
+                            dynamicDicdata[depth, default: []].append(data)
+                            continue
+                        }
+                        let ratio = Self.penaltyRatio[data.lcid]
+                        let pUnit: PValue = Self.getPenalty(data: data) / 2   // 負の値
+                        let adjust = pUnit * info.penalty * ratio
+                        if self.shouldBeRemoved(value: data.value() + adjust, wordCount: data.ruby.count) {
+                            continue
+                        }
+                        dynamicDicdata[depth, default: []].append(data.adjustedData(adjust))
+                    }
+                }
+            }
             // 短期記憶についてはこの位置で処理する
             let result = state.learningMemoryManager.movingTowardPrefixSearchOnTemporaryMemory(charIDs: consume charIDs)
             updated = updated || !(result.dicdata.isEmpty)
@@ -369,6 +477,8 @@ public final class DicdataStore {
                 let katakanaString = String(characters).toKatakana()
                 let dynamicUserDictResult = self.getMatchDynamicUserDict(katakanaString, state: state)
                 updated = updated || !dynamicUserDictResult.isEmpty
+                // LOUDSと同様に、読みの先頭部分として到達できる位置を通知する
+                availableMaxIndex = max(availableMaxIndex, state.dynamicUserDictionary.commonPrefixCount(katakanaString) - 1)
                 for data in dynamicUserDictResult {
                     let depth = characters.endIndex
                     if info.penalty.isZero {
@@ -389,10 +499,13 @@ public final class DicdataStore {
                 generator.setUnreachablePath(target: characters[...(availableMaxIndex + 1)])
             }
             if updated {
-                stringToInfo.append((characters, info))
+                stringToInfo.append((String(characters), info))
+                minCount = min(minCount, characters.count)
             }
         }
-        let minCount = stringToInfo.map {$0.0.count}.min() ?? 0
+        if stringToInfo.isEmpty {
+            minCount = 0
+        }
         return (
             Dictionary(
                 stringToInfo,
@@ -436,19 +549,29 @@ public final class DicdataStore {
     }
 
     package func getDicdataFromLoudstxt3(identifier: String, indices: some Sequence<Int>, state: DicdataStoreState) -> [DicdataElement] {
+        guard ["user", "user_shortcuts", "memory"].contains(identifier) else {
+            return self.getSharedDicdataFromLoudstxt3(identifier: identifier, indices: indices)
+        }
         // Group indices by shard
         let dict = [Int: [Int]].init(grouping: indices, by: { $0 >> DictionaryBuilder.shardShift })
         var data: [DicdataElement] = []
-        if identifier == "user", let userDictionaryURL = state.userDictionaryURL {
+        if identifier == "user", let userDictionaryURL = state.userDictionaryURL,
+           let snapshot = state.userDictionarySnapshot ?? state.refreshUserDictionarySnapshot(in: self) {
+            // LOUDSと同じ版の内容から読み出す
             for (key, value) in dict {
-                let fileID = "\(identifier)\(key)"
+                guard let binary = snapshot.loudstxt3[key] else {
+                    continue
+                }
                 data.append(contentsOf: LOUDS.getUserDictionaryDataForLoudstxt3(
-                    fileID,
+                    "\(identifier)\(key)",
                     indices: value.map { $0 & DictionaryBuilder.localMask },
-                    cache: self.loudstxts[fileID],
+                    cache: binary,
                     userDictionaryURL: userDictionaryURL
                 ))
             }
+            if !snapshot.overlay.isEmpty {
+                data.removeAll { snapshot.overlay.isRemoved($0) }
+            }
             data.mutatingForEach {
                 $0.metadata = .isFromUserDictionary
             }
@@ -481,10 +604,12 @@ public final class DicdataStore {
                 $0.metadata = .isLearned
             }
         }
+        // 統合されたLOUDSのノード番号は先頭文字ごとのファイルとは対応しないため、ユーザ辞書などの識別子では引かない
+        if self.unifiedLOUDS != nil {
+            return data
+        }
         for (key, value) in dict {
-            // Default dictionary shards are stored under escaped identifiers with concatenated shard suffix
-            let escaped = DictionaryBuilder.escapedIdentifier(identifier)
-            let fileID = "\(escaped)\(key)"
+            let fileID = "\(identifier)\(key)"
             data.append(contentsOf: LOUDS.getDataForLoudstxt3(
                 fileID,
                 indices: value.map { $0 & DictionaryBuilder.localMask },
@@ -495,6 +620,126 @@ public final class DicdataStore {
         return data
     }
 
+    /// ユーザ辞書・学習データ以外の共有辞書からエントリを取り出す
+    ///
+    /// 共有辞書は変換中に更新されないため、デコード済みのエントリをノード単位でキャッシュし、ファイルの読み込みはキャッシュになかったノードに限る。
+    private func getSharedDicdataFromLoudstxt3(identifier: String, indices: some Sequence<Int>) -> [DicdataElement] {
+        // Default dictionary shards are stored under escaped identifiers with concatenated shard suffix
+        let escaped = DictionaryBuilder.escapedIdentifier(self.unifiedLOUDS == nil ? identifier : DictionaryBuilder.unifiedIdentifier)
+        var data: [DicdataElement] = []
+        var missedIndices: [Int: [Int]] = [:]
+        for index in indices {
+            if let cached = self.loudstxtEntryCache.value(for: .init(identifier: escaped, nodeIndex: index)) {
+                data.append(contentsOf: cached)
+            } else {
+                missedIndices[index >> DictionaryBuilder.shardShift, default: []].append(index)
+            }
+        }
+        for (key, value) in missedIndices {
+            let fileID = "\(escaped)\(key)"
+            let entries = LOUDS.getEntriesForLoudstxt3(
+                fileID,
+                indices: value.map { $0 & DictionaryBuilder.localMask },
+                cache: self.loudstxts[fileID],
+                dictionaryURL: self.dictionaryURL
+            )
+            for (index, elements) in zip(value, entries) {
+                self.loudstxtEntryCache.insert(elements, for: .init(identifier: escaped, nodeIndex: index))
+                data.append(contentsOf: elements)
+            }
+        }
+        return data
+    }
+
+    /// 共有辞書のエントリキャッシュのヒット数、ミス数、保持しているノード数を返す
+    public func loudstxtCacheStatistics() -> (hits: Int, misses: Int, count: Int) {
+        self.loudstxtEntryCache.statistics
+    }
+
+    /// 共有辞書のエントリキャッシュのヒット数とミス数を0に戻す。キャッシュの内容は保持する
+    public func resetLoudstxtCacheStatistics() {
+        self.loudstxtEntryCache.resetStatistics()
+    }
+
+    /// `userDictionaryURL`のユーザ辞書のコンパイラを返す。未作成であればファイルから読み込んで作成する
+    func userDictionaryCompiler(for userDictionaryURL: URL) -> UserDictionaryCompiler {
+        let key = userDictionaryURL.standardizedFileURL
+        return self.userDictionaryCompilersLock.withLock {
+            if let compiler = self.userDictionaryCompilers[key] {
+                return compiler
+            }
+            let compiler = UserDictionaryCompiler(userDictionaryURL: key, char2UInt8: self.charsID)
+            self.userDictionaryCompilers[key] = compiler
+            return compiler
+        }
+    }
+
+    /// ユーザ辞書に差分を適用する。適用した結果は次の辞書引きから反映される
+    package func applyUserDictionaryChanges(_ changes: [UserDictionaryCompiler.Change], state: DicdataStoreState) {
+        state.userDictionaryCompiler(in: self)?.apply(changes)
+    }
+
+    /// ユーザ辞書の差分をバックグラウンドでLOUDS形式に統合する
+    package func compileUserDictionaryInBackground(state: DicdataStoreState, completion: (@Sendable (Bool) -> Void)? = nil) {
+        guard let compiler = state.userDictionaryCompiler(in: self) else {
+            completion?(false)
+            return
+        }
+        compiler.compileInBackground(completion: completion)
+    }
+
+    /// 辞書引きの範囲。`lookupDicdata(composingText:inputRange:surfaceRange:needTypoCorrection:state:)`の引数に対応する
+    package typealias LookupRange = (
+        inputRange: (startIndex: Int, endIndexRange: Range<Int>?)?,
+        surfaceRange: (startIndex: Int, endIndexRange: Range<Int>?)?
+    )
+
+    /// 並列に辞書引きを行う開始位置の数の下限。これより短い入力ではスレッドを切り替える費用の方が大きい
+    static let concurrentLookupThreshold = 16
+    /// 並列に辞書引きを行うスレッド数の上限
+    static let maxConcurrentLookups = 4
+
+    /// 複数の開始位置について辞書データを取得する
+    ///
+    /// 開始位置ごとの辞書引きは互いに独立しているため、貼り付けや再変換のような長い入力では並列に実行する。
+    /// `DicdataStoreState`に遅延して読み込まれるもの（ユーザ辞書の版、学習データなど）は並列化の前に読み込み、並列に実行している間は読み出しのみとする。
+    /// `DicdataStore`自身のキャッシュは`cacheLock`などで保護されている。
+    /// - Returns: `ranges`と同じ順に並んだ辞書引きの結果。逐次に実行した場合と一致する。
+    package func lookupDicdata(
+        composingText: ComposingText,
+        ranges: [LookupRange],
+        needTypoCorrection: Bool = true,
+        state: DicdataStoreState
+    ) -> [[LatticeNode]] {
+        // この辞書引きの間は全ての開始位置で同じ版のユーザ辞書を用いる
+        state.refreshUserDictionarySnapshot(in: self)
+        let workerCount = min(ranges.count, Self.maxConcurrentLookups, ProcessInfo.processInfo.activeProcessorCount)
+        guard ranges.count >= Self.concurrentLookupThreshold, workerCount > 1 else {
+            return ranges.map {
+                self.lookupDicdataWithCurrentSnapshot(composingText: composingText, inputRange: $0.inputRange, surfaceRange: $0.surfaceRange, needTypoCorrection: needTypoCorrection, state: state)
+            }
+        }
+        for query in ["user", "user_shortcuts", "memory"] {
+            _ = self.loadLOUDS(query: query, state: state)
+        }
+        var results = [[LatticeNode]](repeating: [], count: ranges.count)
+        results.withUnsafeMutableBufferPointer { results in
+            DispatchQueue.concurrentPerform(iterations: workerCount) { worker in
+                // 各スレッドは自分の担当する位置にだけ書き込む
+                for index in stride(from: worker, to: ranges.endIndex, by: workerCount) {
+                    results[index] = self.lookupDicdataWithCurrentSnapshot(
+                        composingText: composingText,
+                        inputRange: ranges[index].inputRange,
+                        surfaceRange: ranges[index].surfaceRange,
+                        needTypoCorrection: needTypoCorrection,
+                        state: state
+                    )
+                }
+            }
+        }
+        return results
+    }
+
     /// 辞書データを取得する
     /// - Parameters:
     ///   - composingText: 現在の入力情報
@@ -509,6 +754,23 @@ public final class DicdataStore {
         needTypoCorrection: Bool = true,
         state: DicdataStoreState
     ) -> [LatticeNode] {
+        // この辞書引きの間は同じ版のユーザ辞書を用いる
+        state.refreshUserDictionarySnapshot(in: self)
+        return self.lookupDicdataWithCurrentSnapshot(composingText: composingText, inputRange: inputRange, surfaceRange: surfaceRange, needTypoCorrection: needTypoCorrection, state: state)
+    }
+
+    /// `state`が現在保持しているユーザ辞書の版を用いて辞書データを取得する。`state`を書き換えないため、並列に呼び出すことができる
+    private func lookupDicdataWithCurrentSnapshot(
+        composingText: ComposingText,
+        inputRange: (startIndex: Int, endIndexRange: Range<Int>?)?,
+        surfaceRange: (startIndex: Int, endIndexRange: Range<Int>?)?,
+        needTypoCorrection: Bool,
+        state: DicdataStoreState
+    ) -> [LatticeNode] {
+        let start = LatencyHistogram.now()
+        defer {
+            ConversionStatistics.lookupDicdata.record(since: start)
+        }
         let inputProcessRange: TypoCorrectionGenerator.ProcessRange?
         if let inputRange {
             let toInputIndexLeft = inputRange.endIndexRange?.startIndex ?? inputRange.startIndex
@@ -561,7 +823,7 @@ public final class DicdataStore {
 
         func penaltizedElementIfFeasible(
             _ element: consuming DicdataElement,
-            rubyCount: Int,
+            rubyCount: @autoclosure () -> Int,
             penalty: PValue
         ) -> DicdataElement? {
             if penalty.isZero {
@@ -570,7 +832,7 @@ public final class DicdataStore {
             let ratio = Self.penaltyRatio[element.lcid]
             let pUnit: PValue = Self.getPenalty(data: element) / 2   // 負の値
             let adjust = pUnit * penalty * ratio
-            if self.shouldBeRemoved(value: element.value() + adjust, wordCount: rubyCount) {
+            if self.shouldBeRemoved(value: element.value() + adjust, wordCount: rubyCount()) {
                 return nil
             } else {
                 return element
@@ -589,11 +851,12 @@ public final class DicdataStore {
 
         latticeNodes.reserveCapacity(latticeNodes.count + additionalDicdata.count)
         for element in consume additionalDicdata {
-            let rubyArray = Array(element.ruby)
-            guard let info = stringToInfo[rubyArray] else {
+            guard let info = stringToInfo[element.ruby] else {
                 continue
             }
-            if let element = penaltizedElementIfFeasible(consume element, rubyCount: rubyArray.count, penalty: info.penalty) {
+            // 文字数はペナルティがある場合にのみ必要になるため、遅延して数える
+            let ruby = element.ruby
+            if let element = penaltizedElementIfFeasible(consume element, rubyCount: ruby.count, penalty: info.penalty) {
                 appendNode(element, endIndex: info.endIndex)
             }
         }
@@ -603,11 +866,11 @@ public final class DicdataStore {
             let items = self.getDicdataFromLoudstxt3(identifier: identifier, indices: value, state: state)
             latticeNodes.reserveCapacity(latticeNodes.count + items.count)
             for element in consume items {
-                let rubyArray = Array(element.ruby)
-                guard let info = stringToInfo[rubyArray] else {
+                guard let info = stringToInfo[element.ruby] else {
                     continue
                 }
-                if let element = penaltizedElementIfFeasible(consume element, rubyCount: rubyArray.count, penalty: info.penalty) {
+                let ruby = element.ruby
+                if let element = penaltizedElementIfFeasible(consume element, rubyCount: ruby.count, penalty: info.penalty) {
                     appendNode(element, endIndex: info.endIndex)
                 }
             }
@@ -635,6 +898,7 @@ public final class DicdataStore {
 
     func getZeroHintPredictionDicdata(lastRcid: Int) -> [DicdataElement] {
         do {
+            FileAccessCounter.recordOpen()
             let csvString = try String(contentsOf: self.dictionaryURL.appendingPathComponent("p/pc_\(lastRcid).csv", isDirectory: false), encoding: .utf8)
             let csvLines = csvString.split(separator: "\n")
             let csvData = csvLines.map {$0.split(separator: ",", omittingEmptySubsequences: false)}
@@ -657,8 +921,11 @@ public final class DicdataStore {
         }
         // 最大700件に絞ることによって低速化を回避する。
         let maxCount = 700
+        // スコアの表がある場合は、上位のノードだけを読み出す
+        let rankedMaxCount = 200
         var result: [DicdataElement] = []
-        let first = String(key.first!)
+        state.refreshUserDictionarySnapshot(in: self)
+        let first = self.sharedDictionaryIdentifier(firstCharacter: key.first!)
         let charIDs = key.map(self.character2charId)
         // 1, 2文字に対する予測変換は候補数が大きいので、depth（〜文字数）を制限する
         let depth = if count == 1 {
@@ -668,7 +935,15 @@ public final class DicdataStore {
         } else {
             Int.max
         }
-        let prefixIndices = self.startingFromPrefixSearch(query: first, charIDs: charIDs, depth: depth, maxCount: maxCount, state: state)
+        let prefixIndices = if let scoreIndex = self.loadPredictionScoreIndex(query: first),
+                               let louds = self.loadLOUDS(query: first, state: state) {
+            // 文字数の差に対するペナルティは予測変換の候補の評価と揃える
+            louds.searchNodeIndex(chars: charIDs).map {
+                scoreIndex.bestNodeIndices(louds: louds, from: $0, maxDepth: depth, maxCount: rankedMaxCount, depthPenalty: 3)
+            } ?? []
+        } else {
+            self.startingFromPrefixSearch(query: first, charIDs: charIDs, depth: depth, maxCount: maxCount, state: state)
+        }
 
         result.append(
             contentsOf: self.getDicdataFromLoudstxt3(identifier: first, indices: Set(prefixIndices), state: state)
@@ -676,6 +951,9 @@ public final class DicdataStore {
         )
         let userDictIndices = self.startingFromPrefixSearch(query: "user", charIDs: charIDs, maxCount: maxCount, state: state)
         result.append(contentsOf: self.getDicdataFromLoudstxt3(identifier: "user", indices: Set(consume userDictIndices), state: state))
+        if let overlay = state.userDictionarySnapshot?.overlay, !overlay.isEmpty {
+            result.append(contentsOf: overlay.prefixMatch(chars: charIDs))
+        }
         if state.learningMemoryManager.enabled {
             let memoryDictIndices = self.startingFromPrefixSearch(query: "memory", charIDs: charIDs, maxCount: maxCount, state: state)
             result.append(contentsOf: self.getDicdataFromLoudstxt3(identifier: "memory", indices: Set(consume memoryDictIndices), state: state))
@@ -715,7 +993,7 @@ public final class DicdataStore {
             let nextIsNumber = j < fullText.count && fullText[j].isNumber
             if !(prevIsNumber || nextIsNumber), let number = Int(convertTarget) {
                 result.append(DicdataElement(ruby: convertTarget, cid: CIDData.数.cid, mid: MIDData.小さい数字.mid, value: -14))
-                if Double(number) <= 1E12 && -1E12 <= Double(number), let kansuji = self.numberFormatter.string(from: NSNumber(value: number)) {
+                if Double(number) <= 1E12 && -1E12 <= Double(number), let kansuji = self.numberFormatterLock.withLock({ self.numberFormatter.string(from: NSNumber(value: number)) }) {
                     result.append(DicdataElement(word: kansuji, ruby: convertTarget, cid: CIDData.数.cid, mid: MIDData.小さい数字.mid, value: -16))
                 }
             }
@@ -860,6 +1138,7 @@ public final class DicdataStore {
 
     private func loadCCBinary(url: URL) -> [(Int32, Float)] {
         do {
+            FileAccessCounter.recordOpen()
             let binaryData = try Data(contentsOf: url, options: [.uncached])
             return binaryData.toArray(of: (Int32, Float).self)
         } catch {
@@ -870,30 +1149,30 @@ public final class DicdataStore {
 
     /// 動的ユーザ辞書からrubyに等しい語を返す。
     func getMatchDynamicUserDict(_ ruby: some StringProtocol, state: DicdataStoreState) -> [DicdataElement] {
-        state.dynamicUserDictionary.filter {$0.ruby == ruby}
+        state.dynamicUserDictionary.match(ruby)
     }
 
     /// 動的ユーザ辞書からrubyに先頭一致する語を返す。
     func getPrefixMatchDynamicUserDict(_ ruby: some StringProtocol, state: DicdataStoreState) -> [DicdataElement] {
-        state.dynamicUserDictionary.filter {$0.ruby.hasPrefix(ruby)}
+        state.dynamicUserDictionary.prefixMatch(ruby)
     }
 
-    private func loadCCLine(_ former: Int) {
+    /// `former`行を読み込み、新たに確保した領域に展開する。ファイルが存在しない行は既定値で埋める
+    private func loadCCLine(_ former: Int) -> UnsafeMutablePointer<PValue> {
         let url = self.dictionaryURL.appending(path: "cb/\(former).binary", directoryHint: .notDirectory)
         let values = self.loadCCBinary(url: url)
-        defer {
-            self.ccParsed[former] = true
-        }
+        let line = UnsafeMutablePointer<PValue>.allocate(capacity: self.cidCount)
         guard !values.isEmpty else {
-            return
+            line.initialize(repeating: -25, count: self.cidCount)
+            return line
         }
         let (firstKey, firstValue) = values[0]
         assert(firstKey == -1)
-        var line = [PValue](repeating: PValue(firstValue), count: self.cidCount)
+        line.initialize(repeating: PValue(firstValue), count: self.cidCount)
         for (k, v) in values.dropFirst() {
             line[Int(k)] = PValue(v)
         }
-        self.ccLines[former] = consume line
+        return line
     }
 
     /// class idから連接確率を得る関数
@@ -905,27 +1184,121 @@ public final class DicdataStore {
     /// - note:
     /// 特定の`former`に対して繰り返し`getCCValue`を実行する場合、`getCCLatter`を用いた方がアクセス効率が良い
     public func getCCValue(_ former: Int, _ latter: Int) -> PValue {
-        if !self.ccParsed[former] {
-            self.loadCCLine(former)
+        if let ccMatrix {
+            return PValue(ccMatrix.row(former)[latter])
+        }
+        return self.ccLine(former)[latter]
+    }
+
+    /// `former`に対応する連接確率の行を返す。未読み込みであれば読み込む。
+    private func ccLine(_ former: Int) -> UnsafeBufferPointer<PValue> {
+        self.cacheLock.withLock {
+            if let line = self.ccLines[former] {
+                return UnsafeBufferPointer(start: line, count: self.cidCount)
+            }
+            let line = self.loadCCLine(former)
+            self.ccLines[former] = line
+            return UnsafeBufferPointer(start: line, count: self.cidCount)
+        }
+    }
+
+    /// 1つの変換器から繰り返し連接確率を得るためのオブジェクトを作成する
+    func makeConnectionCostReader() -> ConnectionCostReader {
+        ConnectionCostReader(dicdataStore: self)
+    }
+
+    /// 1つの変換器が取得した連接確率の行を手元に保持するキャッシュ
+    ///
+    /// `DicdataStore`の行の表は複数の変換器から共有されるため、`cacheLock`を取って参照する。
+    /// 取得した行は`DicdataStore`が解放されるまで書き換えられないので、一度ロックを取って取得した行はこのキャッシュからロックを取らずに参照できる。
+    /// このキャッシュ自体は、1つの変換器の中で同時に1つのスレッドからのみ用いる。
+    final class ConnectionCostReader {
+        fileprivate init(dicdataStore: DicdataStore) {
+            self.dicdataStore = dicdataStore
+            self.lines = .init(repeating: nil, count: dicdataStore.cidCount)
+        }
+
+        private let dicdataStore: DicdataStore
+        private var lines: [UnsafeBufferPointer<PValue>?]
+
+        /// `getCCValue`と同じ値を返す
+        func value(_ former: Int, _ latter: Int) -> PValue {
+            if let ccMatrix = self.dicdataStore.ccMatrix {
+                return PValue(ccMatrix.row(former)[latter])
+            }
+            if let line = self.lines[former] {
+                return line[latter]
+            }
+            let line = self.dicdataStore.ccLine(former)
+            self.lines[former] = line
+            return line[latter]
         }
-        return self.ccLines[former]?[latter] ?? -25
+    }
+
+    /// 連接確率の行数(`former`として取りうる値の数)
+    public var connectionCostRowCount: Int {
+        self.cidCount
+    }
+
+    /// 連接確率の`former`行を事前に読み込んでキャッシュする関数。
+    /// 初回の変換でファイルの読み込みを待たずに済むよう、バックグラウンドから呼ぶことを想定している。
+    public func preloadConnectionCosts(former: Int) {
+        // 行列をメモリマップしている場合は読み込むものがない
+        guard self.ccMatrix == nil else {
+            return
+        }
+        _ = self.ccLine(former)
     }
 
     struct CCLatter: ~Copyable {
         let former: Int
-        let ccLine: [PValue]?
+        /// 連接確率の`former`行。`DicdataStore`が解放されるまで有効
+        let ccLine: UnsafeBufferPointer<PValue>?
+        /// 連接確率の行列の`former`行。行列が存在する場合は`ccLine`の代わりにこれを参照する
+        let matrixRow: UnsafeBufferPointer<Float32>?
 
         borrowing func get(_ latter: Int) -> PValue {
-            self.ccLine?[latter] ?? -25
+            if let matrixRow {
+                return PValue(matrixRow[latter])
+            }
+            return self.ccLine?[latter] ?? -25
+        }
+
+        /// `latters`の各要素に対する連接確率をまとめて`result`の先頭に書き込む
+        ///
+        /// 境界チェックのない連続したループにして、対応する環境ではコンパイラがgather命令を用いてベクトル化できるようにする。
+        borrowing func gather(_ latters: [Int32], into result: inout [PValue]) {
+            if result.count < latters.count {
+                result = [PValue](repeating: 0, count: latters.count)
+            }
+            let matrixRow = self.matrixRow
+            let ccLine = self.ccLine
+            result.withUnsafeMutableBufferPointer { result in
+                latters.withUnsafeBufferPointer { latters in
+                    if let matrixRow {
+                        for i in latters.indices {
+                            result[i] = PValue(matrixRow[Int(latters[i])])
+                        }
+                    } else if let ccLine {
+                        for i in latters.indices {
+                            result[i] = ccLine[Int(latters[i])]
+                        }
+                    } else {
+                        for i in latters.indices {
+                            result[i] = -25
+                        }
+                    }
+                }
+            }
         }
     }
 
     /// 特定の`former`に対して繰り返し`getCCValue`を実行する場合、`getCCLatter`を用いた方がアクセス効率が良い
     func getCCLatter(_ former: Int) -> CCLatter {
-        if !self.ccParsed[former] {
-            self.loadCCLine(former)
+        if let ccMatrix {
+            return CCLatter(former: former, ccLine: nil, matrixRow: ccMatrix.row(former))
         }
-        return CCLatter(former: former, ccLine: self.ccLines[former])
+        return CCLatter(former: former, ccLine: self.ccLine(former), matrixRow: nil)
     }
 
     /// meaning idから意味連接尤度を得る関数
@@ -7,7 +7,7 @@ package final class DicdataStoreState {
     }
 
     var keyboardLanguage: KeyboardLanguage = .ja_JP
-    private(set) var dynamicUserDictionary: [DicdataElement] = []
+    private(set) var dynamicUserDictionary = DynamicUserDictionary()
     var learningMemoryManager: LearningManager
 
     var userDictionaryURL: URL?
@@ -15,8 +15,16 @@ package final class DicdataStoreState {
         self.learningMemoryManager.config.memoryURL
     }
 
-    private(set) var userDictionaryHasLoaded: Bool = false
-    private(set) var userDictionaryLOUDS: LOUDS?
+    /// ユーザ辞書の差分の適用と統合を行うオブジェクト。同じ`userDictionaryURL`を用いる状態の間で共有される
+    private var userDictionaryCompiler: UserDictionaryCompiler?
+    /// 辞書引きに用いているユーザ辞書の版
+    ///
+    /// 1回の辞書引きの間はLOUDSのノード番号とエントリの対応が変わらないよう、`refreshUserDictionarySnapshot`を呼んだ時点の版を使い続ける。
+    private(set) var userDictionarySnapshot: UserDictionaryCompiler.Snapshot?
+    /// 次に`refreshUserDictionarySnapshot`を呼んだ際に、ファイルが他から書き換えられていないか確認するかどうか
+    ///
+    /// 確認にはファイルの読み出しを伴うため、辞書引きごとではなく変換の要求ごとに1回だけ行う。
+    private var needsUserDictionaryModificationCheck = true
 
     // user_shortcuts 辞書
     private(set) var userShortcutsHasLoaded: Bool = false
@@ -28,11 +36,38 @@ package final class DicdataStoreState {
     func updateUserDictionaryURL(_ newURL: URL) {
         if self.userDictionaryURL != newURL {
             self.userDictionaryURL = newURL
-            self.userDictionaryLOUDS = nil
-            self.userDictionaryHasLoaded = false
+            self.userDictionaryCompiler = nil
+            self.userDictionarySnapshot = nil
         }
     }
 
+    /// ユーザ辞書のコンパイラを返す。未取得であれば`userDictionaryURL`に対応するものを`dicdataStore`から取得する
+    func userDictionaryCompiler(in dicdataStore: DicdataStore) -> UserDictionaryCompiler? {
+        guard let userDictionaryURL else {
+            return nil
+        }
+        if let userDictionaryCompiler {
+            return userDictionaryCompiler
+        }
+        let compiler = dicdataStore.userDictionaryCompiler(for: userDictionaryURL)
+        self.userDictionaryCompiler = compiler
+        return compiler
+    }
+
+    /// ユーザ辞書の最新の版を取得し、以降の辞書引きで用いる
+    ///
+    /// 変換の要求後に初めて呼ばれた場合は、ファイルが他のプロセスなどから書き換えられていれば読み込み直す。
+    @discardableResult
+    func refreshUserDictionarySnapshot(in dicdataStore: DicdataStore) -> UserDictionaryCompiler.Snapshot? {
+        let compiler = self.userDictionaryCompiler(in: dicdataStore)
+        if self.needsUserDictionaryModificationCheck {
+            self.needsUserDictionaryModificationCheck = false
+            compiler?.reloadIfModified()
+        }
+        self.userDictionarySnapshot = compiler?.snapshot
+        return self.userDictionarySnapshot
+    }
+
     func updateKeyboardLanguage(_ newLanguage: KeyboardLanguage) {
         self.keyboardLanguage = newLanguage
     }
@@ -51,11 +86,6 @@ package final class DicdataStoreState {
         self.memoryHasLoaded = true
     }
 
-    func updateUserDictionaryLOUDS(_ newLOUDS: LOUDS?) {
-        self.userDictionaryLOUDS = newLOUDS
-        self.userDictionaryHasLoaded = true
-    }
-
     func updateUserShortcutsLOUDS(_ newLOUDS: LOUDS?) {
         self.userShortcutsLOUDS = newLOUDS
         self.userShortcutsHasLoaded = true
@@ -67,15 +97,18 @@ package final class DicdataStoreState {
             self.keyboardLanguage = options.keyboardLanguage
         }
         self.updateUserDictionaryURL(options.sharedContainerURL)
+        // 変換の要求ごとに、ユーザ辞書が他から書き換えられていないか確認する
+        self.needsUserDictionaryModificationCheck = true
         let learningConfig = LearningConfig(learningType: options.learningType, maxMemoryCount: options.maxMemoryCount, memoryURL: options.memoryDirectoryURL)
         self.updateLearningConfig(learningConfig)
     }
 
     func importDynamicUserDictionary(_ dicdata: [DicdataElement]) {
-        self.dynamicUserDictionary = dicdata
-        self.dynamicUserDictionary.mutatingForEach {
+        var dicdata = dicdata
+        dicdata.mutatingForEach {
             $0.metadata = .isFromUserDictionary
         }
+        self.dynamicUserDictionary = DynamicUserDictionary(dicdata)
     }
 
     private func resetMemoryLOUDSCache() {
@@ -0,0 +1,76 @@
+/// 動的ユーザ辞書。読みの辞書順に並べた索引を持ち、完全一致・前方一致の検索を二分探索で行う
+///
+/// 辞書引きでは部分文字列ごとに検索するため、全件を走査する代わりにこの索引を用いる。
+struct DynamicUserDictionary: Sendable {
+    init(_ dicdata: [DicdataElement] = []) {
+        self.dicdata = dicdata
+        self.sortedIndices = dicdata.indices.sorted { (lhs, rhs) in
+            if dicdata[lhs].ruby != dicdata[rhs].ruby {
+                return dicdata[lhs].ruby < dicdata[rhs].ruby
+            }
+            return lhs < rhs
+        }
+    }
+
+    /// 登録された順のエントリ
+    private(set) var dicdata: [DicdataElement]
+    /// `dicdata`の位置を読みの辞書順に並べたもの
+    private var sortedIndices: [Int]
+
+    var isEmpty: Bool {
+        self.dicdata.isEmpty
+    }
+
+    /// `sortedIndices`のうち、読みが`ruby`以上となる最初の位置
+    private func lowerBound(_ ruby: String) -> Int {
+        var low = 0
+        var high = self.sortedIndices.endIndex
+        while low < high {
+            let mid = (low + high) / 2
+            if self.dicdata[self.sortedIndices[mid]].ruby < ruby {
+                low = mid + 1
+            } else {
+                high = mid
+            }
+        }
+        return low
+    }
+
+    /// `lowerBound`から`condition`を満たす間のエントリを登録された順に返す
+    private func collect(from start: Int, while condition: (String) -> Bool) -> [DicdataElement] {
+        var indices: [Int] = []
+        for index in self.sortedIndices[start...] {
+            guard condition(self.dicdata[index].ruby) else {
+                break
+            }
+            indices.append(index)
+        }
+        return indices.sorted().map { self.dicdata[$0] }
+    }
+
+    /// 読みが`ruby`に等しい語を返す
+    func match(_ ruby: some StringProtocol) -> [DicdataElement] {
+        let ruby = String(ruby)
+        return self.collect(from: self.lowerBound(ruby)) { $0 == ruby }
+    }
+
+    /// 読みが`ruby`に先頭一致する語を返す
+    func prefixMatch(_ ruby: some StringProtocol) -> [DicdataElement] {
+        let ruby = String(ruby)
+        return self.collect(from: self.lowerBound(ruby)) { $0.hasPrefix(ruby) }
+    }
+
+    /// `ruby`の先頭から何文字までがいずれかの語の読みの先頭部分と一致するかを返す
+    ///
+    /// 辞書順で`ruby`の直前・直後に並ぶ読みとの共通接頭辞が最長になるため、その2つだけを調べる。
+    func commonPrefixCount(_ ruby: some StringProtocol) -> Int {
+        let ruby = String(ruby)
+        let position = self.lowerBound(ruby)
+        var result = 0
+        for neighbor in [position - 1, position] where self.sortedIndices.indices.contains(neighbor) {
+            let count = zip(ruby, self.dicdata[self.sortedIndices[neighbor]].ruby).prefix(while: { $0.0 == $0.1 }).count
+            result = max(result, count)
+        }
+        return result
+    }
+}
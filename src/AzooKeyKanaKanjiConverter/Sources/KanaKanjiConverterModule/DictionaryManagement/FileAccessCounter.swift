@@ -0,0 +1,24 @@
+public import Foundation
+
+/// 辞書などのファイル読み込み回数を数えるデバッグ用のカウンタ
+///
+/// キー入力ごとの変換処理でファイルI/Oが発生していないことを確かめるために利用する。
+public enum FileAccessCounter {
+    private static let lock = NSLock()
+    nonisolated(unsafe) private static var _count: Int = 0
+
+    /// これまでに行われたファイル読み込みの回数
+    public static var count: Int {
+        lock.withLock { _count }
+    }
+
+    /// カウンタを0に戻す
+    public static func reset() {
+        lock.withLock { _count = 0 }
+    }
+
+    /// ファイルを1つ読み込む直前に呼ぶ
+    static func recordOpen() {
+        lock.withLock { _count += 1 }
+    }
+}
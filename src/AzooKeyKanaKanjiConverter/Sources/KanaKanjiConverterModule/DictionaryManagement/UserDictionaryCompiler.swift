@@ -0,0 +1,371 @@
+import Foundation
+import SwiftUtils
+
+/// ユーザ辞書に対する追加・削除を差分として受け付け、バックグラウンドでLOUDS形式に統合するクラス
+///
+/// 差分は`UserDictionaryOverlay`（小さな可変のトライ）に保持し、辞書引きでは統合済みのLOUDSとあわせて参照する。
+/// 統合が終わると、読み出し側が参照する`Snapshot`をロックの内側で差し替える。
+/// 差し替えは参照の入れ替えだけなので、変換中の読み出しは古い`Snapshot`をそのまま使い続けられる。
+///
+/// 統合の結果は`user.versions/<版>`に書き出し、どの版を用いるかを`user.current`に記録する。
+/// `user.current`の書き換えは1回のリネームで行うため、読み込む側が異なる版の`.louds`とシャードを組み合わせることはない。
+/// 同じディレクトリに対するコンパイラは`DicdataStore.userDictionaryCompiler(for:)`から共有して用いる。
+/// 他のプロセスや設定アプリがファイルを書き換えた場合は、`Generation`の変化を検知して読み込み直す。
+package final class UserDictionaryCompiler: @unchecked Sendable {
+    package enum Change: Sendable {
+        /// エントリを追加する
+        case add(DicdataElement)
+        /// 読みと表層形が一致するエントリを全て削除する
+        case remove(ruby: String, word: String)
+    }
+
+    /// ある時点のユーザ辞書。作成後は変更されない
+    package final class Snapshot: @unchecked Sendable {
+        init(louds: LOUDS?, loudstxt3: [Int: Data], overlay: UserDictionaryOverlay) {
+            self.louds = louds
+            self.loudstxt3 = loudstxt3
+            self.overlay = overlay
+        }
+
+        /// 統合済みのLOUDS
+        let louds: LOUDS?
+        /// 統合済みの`user<shard>.loudstxt3`の内容。統合中にファイルが書き換えられても影響を受けないよう、メモリ上に保持する
+        let loudstxt3: [Int: Data]
+        /// まだ統合されていない差分
+        let overlay: UserDictionaryOverlay
+
+        /// 統合済みのエントリを全て列挙する
+        func compiledEntries() -> [DicdataElement] {
+            self.loudstxt3.sorted(by: { $0.key < $1.key }).flatMap { LOUDS.parseAllLoudstxt3Entries(binary: $0.value) }
+        }
+    }
+
+    /// ディレクトリに書き出されたユーザ辞書の世代。読み込んだ後にファイルが書き換えられたかどうかの判定に用いる
+    struct Generation: Equatable, Sendable {
+        /// `user.current`に記録された版の名前
+        var version: String?
+        /// `user.current`の更新日時
+        var manifestModificationDate: Date?
+        /// ディレクトリ直下の`user.louds`の更新日時
+        var flatModificationDate: Date?
+    }
+
+    init(userDictionaryURL: URL, char2UInt8: [Character: UInt8]) {
+        self.userDictionaryURL = userDictionaryURL
+        self.char2UInt8 = char2UInt8
+        // 読み込み中に書き換えられた場合に次回の確認で読み込み直すよう、世代は読み込む前に取得する
+        self.generation = Self.publishedGeneration(in: userDictionaryURL)
+        self.current = Self.loadSnapshot(directoryURL: Self.publishedDirectoryURL(in: userDictionaryURL), overlay: UserDictionaryOverlay())
+    }
+
+    /// 現在の版の名前を記録するファイル
+    static let manifestName = "user.current"
+    /// 統合した版を格納するディレクトリ
+    static let versionsDirectoryName = "user.versions"
+
+    private let userDictionaryURL: URL
+    private let char2UInt8: [Character: UInt8]
+    private let lock = NSLock()
+    /// 統合処理を1つずつ実行するためのロック
+    private let compileLock = NSLock()
+    private var current: Snapshot
+    /// `current`の読み込み元の世代
+    private var generation: Generation
+    /// `current.louds`に統合されていない変更。統合中に届いた変更を統合後の差分として残すため、通し番号とともに保持する
+    private var pendingChanges: [(sequence: Int, change: Change)] = []
+    private var nextSequence = 0
+
+    /// 現在の版
+    package var snapshot: Snapshot {
+        self.lock.withLock {
+            self.current
+        }
+    }
+
+    /// 変更を差分として適用する。適用した結果は直ちに`snapshot`に反映される
+    package func apply(_ changes: [Change]) {
+        self.lock.withLock {
+            var overlay = self.current.overlay
+            for change in changes {
+                self.pendingChanges.append((self.nextSequence, change))
+                self.nextSequence += 1
+                overlay.apply(change, char2UInt8: self.char2UInt8)
+            }
+            self.current = Snapshot(louds: self.current.louds, loudstxt3: self.current.loudstxt3, overlay: overlay)
+        }
+    }
+
+    /// ファイルが他から書き換えられていれば読み込み直し、`snapshot`を差し替える。未統合の差分は新しい版の差分として残す
+    ///
+    /// 統合中は統合の完了時に世代が更新されるため、確認せずに`false`を返す。
+    /// - Returns: 読み込み直した場合は`true`
+    @discardableResult
+    package func reloadIfModified() -> Bool {
+        guard self.compileLock.try() else {
+            return false
+        }
+        defer {
+            self.compileLock.unlock()
+        }
+        return self.reloadIfModifiedWithoutCompileLock()
+    }
+
+    /// `compileLock`の内側で呼ぶ
+    private func reloadIfModifiedWithoutCompileLock() -> Bool {
+        let generation = Self.publishedGeneration(in: self.userDictionaryURL)
+        guard generation != self.lock.withLock({ self.generation }) else {
+            return false
+        }
+        let loaded = Self.loadSnapshot(directoryURL: Self.publishedDirectoryURL(in: self.userDictionaryURL), overlay: UserDictionaryOverlay())
+        self.lock.withLock {
+            self.current = Snapshot(louds: loaded.louds, loudstxt3: loaded.loudstxt3, overlay: self.current.overlay)
+            self.generation = generation
+        }
+        return true
+    }
+
+    /// 差分をLOUDS形式に統合してファイルに書き出し、`snapshot`を差し替える
+    ///
+    /// 統合は、書き出されている最新の版のエントリ全体に差分を適用してLOUDSを作り直すことで行う。
+    /// - Returns: 統合すべき差分がなかった場合は`false`
+    @discardableResult
+    package func compile() throws -> Bool {
+        try self.compileLock.withLock {
+            // 他から書き換えられた版を上書きしないよう、最新の版に対して差分を適用する
+            _ = self.reloadIfModifiedWithoutCompileLock()
+            let (base, changes) = self.lock.withLock {
+                (self.current, self.pendingChanges)
+            }
+            guard let lastSequence = changes.last?.sequence else {
+                return false
+            }
+            var entries = base.compiledEntries()
+            for (_, change) in changes {
+                switch change {
+                case .add(let element):
+                    entries.append(element)
+                case .remove(let ruby, let word):
+                    entries.removeAll { $0.ruby == ruby && $0.word == word }
+                }
+            }
+            // 新しい版のディレクトリに書き出し、`user.current`を書き換えて切り替える
+            let fileManager = FileManager.default
+            let versionsURL = self.userDictionaryURL.appendingPathComponent(Self.versionsDirectoryName, isDirectory: true)
+            let version = UUID().uuidString
+            let versionURL = versionsURL.appendingPathComponent(version, isDirectory: true)
+            let previousVersion = Self.publishedVersion(in: self.userDictionaryURL)
+            let compiled: Snapshot
+            do {
+                try fileManager.createDirectory(at: versionURL, withIntermediateDirectories: true)
+                try DictionaryBuilder.exportDictionary(entries: entries, to: versionURL, baseName: "user", shardByFirstCharacter: false, char2UInt8: self.char2UInt8)
+                compiled = Self.loadSnapshot(directoryURL: versionURL, overlay: UserDictionaryOverlay())
+                // `.atomic`は一時ファイルに書き出してからリネームするため、読み込む側は切り替え前後のどちらかの版だけを見る
+                try Data(version.utf8).write(to: self.userDictionaryURL.appendingPathComponent(Self.manifestName, isDirectory: false), options: .atomic)
+            } catch {
+                try? fileManager.removeItem(at: versionURL)
+                throw error
+            }
+            // 直前の版は、切り替え前に`user.current`を読んだ読み込み側のために残しておく
+            for name in (try? fileManager.contentsOfDirectory(atPath: versionsURL.path)) ?? [] where name != version && name != previousVersion {
+                try? fileManager.removeItem(at: versionsURL.appendingPathComponent(name, isDirectory: true))
+            }
+            let generation = Self.publishedGeneration(in: self.userDictionaryURL)
+
+            self.lock.withLock {
+                // 統合中に届いた変更は、新しい版の差分として残す
+                self.pendingChanges.removeAll { $0.sequence <= lastSequence }
+                var overlay = UserDictionaryOverlay()
+                for (_, change) in self.pendingChanges {
+                    overlay.apply(change, char2UInt8: self.char2UInt8)
+                }
+                self.current = Snapshot(louds: compiled.louds, loudstxt3: compiled.loudstxt3, overlay: overlay)
+                // 自身の書き出しによる変化で読み込み直さないよう、書き出した後の世代を記録する
+                self.generation = generation
+            }
+            return true
+        }
+    }
+
+    /// `compile()`をバックグラウンドで実行する
+    package func compileInBackground(completion: (@Sendable (Bool) -> Void)? = nil) {
+        DispatchQueue.global(qos: .utility).async {
+            do {
+                completion?(try self.compile())
+            } catch {
+                debug("Error: ユーザ辞書の統合に失敗しました。差分はそのまま保持されます。Description: \(error)")
+                completion?(false)
+            }
+        }
+    }
+
+    /// `user.current`に記録された版の名前
+    private static func publishedVersion(in userDictionaryURL: URL) -> String? {
+        let manifestURL = userDictionaryURL.appendingPathComponent(Self.manifestName, isDirectory: false)
+        guard let data = FileManager.default.contents(atPath: manifestURL.path),
+              let version = String(data: data, encoding: .utf8)?.trimmingCharacters(in: .whitespacesAndNewlines),
+              !version.isEmpty, !version.contains("/") else {
+            return nil
+        }
+        return version
+    }
+
+    /// ユーザ辞書のファイルを読み込むディレクトリ
+    ///
+    /// `user.current`が指す版を用いる。版がない場合や、ディレクトリ直下に別途書き出された`user.louds`の方が新しい場合は直下のファイルを用いる。
+    static func publishedDirectoryURL(in userDictionaryURL: URL) -> URL {
+        guard let version = Self.publishedVersion(in: userDictionaryURL) else {
+            return userDictionaryURL
+        }
+        let versionURL = userDictionaryURL
+            .appendingPathComponent(Self.versionsDirectoryName, isDirectory: true)
+            .appendingPathComponent(version, isDirectory: true)
+        let fileManager = FileManager.default
+        guard fileManager.fileExists(atPath: versionURL.path) else {
+            return userDictionaryURL
+        }
+        if let flatDate = Self.modificationDate(userDictionaryURL.appendingPathComponent("user.louds", isDirectory: false)),
+           let manifestDate = Self.modificationDate(userDictionaryURL.appendingPathComponent(Self.manifestName, isDirectory: false)),
+           flatDate > manifestDate {
+            return userDictionaryURL
+        }
+        return versionURL
+    }
+
+    /// `userDictionaryURL`に書き出されているユーザ辞書の世代
+    static func publishedGeneration(in userDictionaryURL: URL) -> Generation {
+        Generation(
+            version: Self.publishedVersion(in: userDictionaryURL),
+            manifestModificationDate: Self.modificationDate(userDictionaryURL.appendingPathComponent(Self.manifestName, isDirectory: false)),
+            flatModificationDate: Self.modificationDate(userDictionaryURL.appendingPathComponent("user.louds", isDirectory: false))
+        )
+    }
+
+    private static func modificationDate(_ url: URL) -> Date? {
+        (try? FileManager.default.attributesOfItem(atPath: url.path))?[.modificationDate] as? Date
+    }
+
+    /// `directoryURL`にある`user<shard>.loudstxt3`の一覧
+    private static func shardFiles(in directoryURL: URL) -> [(shard: Int, name: String)] {
+        let names = (try? FileManager.default.contentsOfDirectory(atPath: directoryURL.path)) ?? []
+        return names.compactMap { name in
+            guard name.hasPrefix("user"), name.hasSuffix(".loudstxt3"),
+                  let shard = Int(name.dropFirst("user".count).dropLast(".loudstxt3".count)) else {
+                return nil
+            }
+            return (shard, name)
+        }
+    }
+
+    private static func loadSnapshot(directoryURL: URL, overlay: UserDictionaryOverlay) -> Snapshot {
+        guard let louds = LOUDS.loadUserDictionary(userDictionaryURL: directoryURL) else {
+            debug("Error: ユーザ辞書のloudsファイルの読み込みに失敗しましたが、このエラーは深刻ではありません。")
+            return Snapshot(louds: nil, loudstxt3: [:], overlay: overlay)
+        }
+        var loudstxt3: [Int: Data] = [:]
+        for (shard, name) in Self.shardFiles(in: directoryURL) {
+            FileAccessCounter.recordOpen()
+            loudstxt3[shard] = try? Data(contentsOf: directoryURL.appendingPathComponent(name, isDirectory: false))
+        }
+        return Snapshot(louds: louds, loudstxt3: loudstxt3, overlay: overlay)
+    }
+}
+
+/// ユーザ辞書に対する、まだLOUDS形式に統合されていない追加・削除を保持する小さな可変のトライ
+package struct UserDictionaryOverlay: Sendable {
+    private struct Node: Sendable {
+        var dataIndices: [Int] = []
+        var children: [UInt8: Int] = [:]
+    }
+
+    private struct Key: Hashable, Sendable {
+        var ruby: String
+        var word: String
+    }
+
+    private var nodes = [Node()]
+    private var dicdata: [DicdataElement] = []
+    /// 削除されたエントリ。統合済みのLOUDSから読み出したデータに適用する
+    private var removed: Set<Key> = []
+
+    /// 差分がない場合は`true`
+    var isEmpty: Bool {
+        self.dicdata.isEmpty && self.removed.isEmpty
+    }
+
+    mutating func apply(_ change: UserDictionaryCompiler.Change, char2UInt8: [Character: UInt8]) {
+        switch change {
+        case .add(var element):
+            guard let chars = LearningManager.keyToChars(element.ruby, char2UInt8: char2UInt8) else {
+                return
+            }
+            var index = 0
+            for char in chars {
+                if let nextIndex = self.nodes[index].children[char] {
+                    index = nextIndex
+                } else {
+                    let nextIndex = self.nodes.endIndex
+                    self.nodes[index].children[char] = nextIndex
+                    self.nodes.append(Node())
+                    index = nextIndex
+                }
+            }
+            element.metadata = .isFromUserDictionary
+            self.nodes[index].dataIndices.append(self.dicdata.endIndex)
+            self.dicdata.append(element)
+        case .remove(let ruby, let word):
+            self.removed.insert(Key(ruby: ruby, word: word))
+            guard let index = self.nodeIndex(chars: LearningManager.keyToChars(ruby, char2UInt8: char2UInt8) ?? []) else {
+                return
+            }
+            self.nodes[index].dataIndices.removeAll {
+                self.dicdata[$0].word == word
+            }
+        }
+    }
+
+    /// 統合済みのLOUDSから読み出した`element`が削除されているかどうか
+    func isRemoved(_ element: DicdataElement) -> Bool {
+        !self.removed.isEmpty && self.removed.contains(Key(ruby: element.ruby, word: element.word))
+    }
+
+    private func nodeIndex(chars: [UInt8]) -> Int? {
+        var index = 0
+        for char in chars {
+            guard let nextIndex = self.nodes[index].children[char] else {
+                return nil
+            }
+            index = nextIndex
+        }
+        return index
+    }
+
+    func movingTowardPrefixSearch(chars: [UInt8], depth: Range<Int>) -> (dicdata: [Int: [DicdataElement]], availableMaxIndex: Int) {
+        var index = 0
+        var availableMaxIndex = 0
+        var indices: [Int: [Int]] = [:]
+        for (offset, char) in chars.enumerated() {
+            guard let nextIndex = self.nodes[index].children[char] else {
+                break
+            }
+            availableMaxIndex = offset
+            index = nextIndex
+            if depth.contains(offset), !self.nodes[index].dataIndices.isEmpty {
+                indices[offset] = self.nodes[index].dataIndices
+            }
+        }
+        return (indices.mapValues { items in items.map { self.dicdata[$0] }}, availableMaxIndex)
+    }
+
+    func prefixMatch(chars: [UInt8]) -> [DicdataElement] {
+        guard let index = self.nodeIndex(chars: chars) else {
+            return []
+        }
+        var nodeIndices: [Int] = Array(self.nodes[index].children.values)
+        var indices: [Int] = self.nodes[index].dataIndices
+        while let index = nodeIndices.popLast() {
+            nodeIndices.append(contentsOf: self.nodes[index].children.values)
+            indices.append(contentsOf: self.nodes[index].dataIndices)
+        }
+        return indices.map { self.dicdata[$0] }
+    }
+}
@@ -67,7 +67,7 @@ public struct ComposingText: Sendable {
     }
 
     /// inputとsurfaceのインデックス対応関係
-    private struct IndexPair {
+    struct IndexPair: Sendable, Equatable {
         let inputIndex: Int
         let surfaceIndex: Int
     }
@@ -103,35 +103,48 @@ public struct ComposingText: Sendable {
         //    `か`と`んしゃ`は、それぞれを編集しても他方に影響を与えるない独立セグメント
         //    境界のinputとsurfaceのインデックスペアのリスト[{0, 0}, {2(a), 1(か)}, {6(a), 4{ゃ}}] が返される
 
-        var independentSegmentBoundaries = [IndexPair(inputIndex: 0, surfaceIndex: 0)]
-        var converting: [ConvertTargetElement] = []
-        var convertedLength = 0
+        var builder = IndependentSegmentBoundaryBuilder()
+        for element in self.input {
+            builder.append(element)
+        }
+        return builder.boundaries
+    }
 
-        for (currentInputIndex, element) in input.enumerated() {
+    /// `input`の先頭から1要素ずつ独立セグメントの境界を求める
+    ///
+    /// 入力の末尾に要素を追加した場合は、それまでの状態を保持したまま続きの要素だけを`append`すればよい。
+    struct IndependentSegmentBoundaryBuilder {
+        /// 境界にあたるinputとsurfaceのインデックスの組
+        private(set) var boundaries = [IndexPair(inputIndex: 0, surfaceIndex: 0)]
+        /// これまでに追加した要素の数
+        private(set) var inputCount = 0
+        private var converting: [ConvertTargetElement] = []
+        private var convertedLength = 0
+
+        mutating func append(_ element: InputElement) {
             // 現在の文字を入力した際に関連(依存)した文字列の長さ
-            let deletedCount = Self.updateConvertTargetElements(currentElements: &converting, newElement: element)
+            let deletedCount = ComposingText.updateConvertTargetElements(currentElements: &self.converting, newElement: element)
 
-            let previousConvertedLength = convertedLength
-            convertedLength = converting.reduce(0) { $0 + $1.string.count }
+            let previousConvertedLength = self.convertedLength
+            self.convertedLength = self.converting.reduce(0) { $0 + $1.string.count }
 
             // 今回の文字入力による変換が、前の暫定独立セグメントの文字を含むローマ字テーブルエントリによって行われた場合
             // 入力は前のセグメントに依存しているので、前のセグメントとの境界を消し、より長い独立セグメントにする
             // 文字列に影響を与えなかった入力はsurfaceの長さ0のセグメントとして扱われる
-            while let lastIndependentSegment = independentSegmentBoundaries.popLast() {
+            while let lastIndependentSegment = self.boundaries.popLast() {
                 // deletedCount分遡るまでにある境界を消す
                 if lastIndependentSegment.surfaceIndex <= previousConvertedLength - deletedCount {
                     // deletedCount以上前の文字には依存していないので一度消した境界を戻す
-                    independentSegmentBoundaries.append(lastIndependentSegment)
+                    self.boundaries.append(lastIndependentSegment)
                     break
                 }
             }
+            self.inputCount += 1
             // 現在の終端をセグメント境界と仮定する
-            independentSegmentBoundaries.append(
-                IndexPair(inputIndex: currentInputIndex + 1, surfaceIndex: convertedLength)
+            self.boundaries.append(
+                IndexPair(inputIndex: self.inputCount, surfaceIndex: self.convertedLength)
             )
         }
-
-        return independentSegmentBoundaries
     }
 
     /// `targetSurfaceIndex`に対応するinputの位置を無理やり作り出す関数
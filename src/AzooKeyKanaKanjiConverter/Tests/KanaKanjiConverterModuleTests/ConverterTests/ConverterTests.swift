@@ -44,6 +44,110 @@ final class ConverterTests: XCTestCase {
         }
     }
 
+    // 中断された変換は結果を返さず、その後の変換には影響しない
+    func testCancelledConversion() throws {
+        let converter = KanaKanjiConverter(dictionaryURL: dictionaryURL())
+        var c = ComposingText()
+        c.insertAtCursorPosition("あいうえお", inputStyle: .direct)
+
+        let cancellation = ConversionCancellation()
+        cancellation.cancel()
+        XCTAssertTrue(cancellation.isCancelled)
+        let cancelled = converter.requestCandidates(c, options: requestOptions(), cancellation: cancellation)
+        XCTAssertTrue(cancelled.mainResults.isEmpty)
+
+        let results = converter.requestCandidates(c, options: requestOptions(), cancellation: ConversionCancellation())
+        XCTAssertFalse(results.mainResults.isEmpty)
+    }
+
+    // 単語候補を後回しにした場合も、続きを取得すれば全体の候補と一致する
+    func testDeferredWordCandidates() throws {
+        var c = ComposingText()
+        c.insertAtCursorPosition("かんじ", inputStyle: .direct)
+
+        let full = KanaKanjiConverter(dictionaryURL: dictionaryURL()).requestCandidates(c, options: requestOptions())
+
+        let converter = KanaKanjiConverter(dictionaryURL: dictionaryURL())
+        let top = converter.requestCandidates(c, options: requestOptions(), deferWordCandidates: true)
+        XCTAssertLessThanOrEqual(top.mainResults.count, full.mainResults.count)
+        let rest = converter.requestDeferredCandidates(c, mainResults: top.mainResults, options: requestOptions())
+        XCTAssertEqual((top.mainResults + rest).map(\.text), full.mainResults.map(\.text))
+
+        // 入力が変わった場合は何も返さない
+        var d = c
+        d.insertAtCursorPosition("を", inputStyle: .direct)
+        XCTAssertTrue(converter.requestDeferredCandidates(d, mainResults: top.mainResults, options: requestOptions()).isEmpty)
+    }
+
+    // 候補を早期に返す場合（完全一致のみを要求した場合）は、後から取得する候補も全体の候補に含まれるものだけになる
+    func testDeferredWordCandidatesAfterEarlyReturn() throws {
+        var c = ComposingText()
+        c.insertAtCursorPosition("かんじ", inputStyle: .direct)
+        var options = requestOptions()
+        options.requestQuery = .完全一致
+
+        let full = KanaKanjiConverter(dictionaryURL: dictionaryURL()).requestCandidates(c, options: options)
+
+        let converter = KanaKanjiConverter(dictionaryURL: dictionaryURL())
+        let top = converter.requestCandidates(c, options: options, deferWordCandidates: true)
+        // 先頭の候補より後ろのページを要求した場合に相当する
+        let rest = converter.requestDeferredCandidates(c, mainResults: top.mainResults, options: options)
+        XCTAssertTrue(rest.isEmpty)
+        XCTAssertEqual((top.mainResults + rest).map(\.text), full.mainResults.map(\.text))
+        XCTAssertEqual(Array(full.mainResults.dropFirst(top.mainResults.count)).map(\.text), rest.map(\.text))
+    }
+
+    // 中断された変換の途中結果は次回の差分更新に使われない
+    func testCancelledConversionDoesNotAffectNextConversion() throws {
+        let converter = KanaKanjiConverter(dictionaryURL: dictionaryURL())
+        var c = ComposingText()
+        c.insertAtCursorPosition("かんじ", inputStyle: .direct)
+        _ = converter.requestCandidates(c, options: requestOptions())
+
+        c.insertAtCursorPosition("を", inputStyle: .direct)
+        let cancellation = ConversionCancellation()
+        cancellation.cancel()
+        let cancelled = converter.requestCandidates(c, options: requestOptions(), cancellation: cancellation)
+        XCTAssertTrue(cancelled.mainResults.isEmpty)
+
+        c.insertAtCursorPosition("かく", inputStyle: .direct)
+        let result = converter.requestCandidates(c, options: requestOptions())
+        let expected = KanaKanjiConverter(dictionaryURL: dictionaryURL()).requestCandidates(c, options: requestOptions())
+        XCTAssertFalse(result.mainResults.isEmpty)
+        XCTAssertEqual(result.mainResults.map(\.text), expected.mainResults.map(\.text))
+    }
+
+    // 入力中は同じ領域にノードを追加し、入力を終えた後の変換では領域を容量ごと再利用する
+    func testLatticeArenaIsReusedAcrossConversions() throws {
+        let converter = KanaKanjiConverter(dictionaryURL: dictionaryURL())
+        var c = ComposingText()
+        c.insertAtCursorPosition("かんじ", inputStyle: .direct)
+        _ = converter.requestCandidates(c, options: requestOptions())
+        let storage = converter.latticeArena.storageIdentifier
+        let firstCount = converter.latticeArena.count
+        XCTAssertGreaterThan(firstCount, 0)
+
+        // 差分更新では前回のノードを参照するため、同じ領域に追加される
+        c.insertAtCursorPosition("を", inputStyle: .direct)
+        _ = converter.requestCandidates(c, options: requestOptions())
+        XCTAssertEqual(converter.latticeArena.storageIdentifier, storage)
+        XCTAssertGreaterThan(converter.latticeArena.count, firstCount)
+
+        // 入力を終えると前回のラティスが手放され、領域は容量を残したまま空になる
+        let capacity = converter.latticeArena.capacity
+        converter.stopComposition()
+        XCTAssertEqual(converter.latticeArena.storageIdentifier, storage)
+        XCTAssertEqual(converter.latticeArena.count, 0)
+        XCTAssertEqual(converter.latticeArena.capacity, capacity)
+
+        var d = ComposingText()
+        d.insertAtCursorPosition("かんじ", inputStyle: .direct)
+        _ = converter.requestCandidates(d, options: requestOptions())
+        XCTAssertEqual(converter.latticeArena.storageIdentifier, storage)
+        XCTAssertEqual(converter.latticeArena.count, firstCount)
+        XCTAssertEqual(converter.latticeArena.capacity, capacity)
+    }
+
     private func tmpDir(_ name: String) throws -> URL {
         let workspace = URL(fileURLWithPath: FileManager.default.currentDirectoryPath, isDirectory: true)
         let base = workspace.appendingPathComponent("TestsTmp", isDirectory: true)
@@ -85,4 +85,188 @@ final class DicdataStoreTests: XCTestCase {
             XCTFail("searchNodeIndex failed for user ruby 'か'")
         }
     }
+
+    func testUserDictionaryCompilerAppliesChangesAndCompiles() throws {
+        let userDir = try tmpDir("user-compile")
+        defer {
+            try? FileManager.default.removeItem(at: userDir)
+        }
+        let entries: [DicdataElement] = [
+            DicdataElement(word: "亜", ruby: "あ", lcid: 10, rcid: 10, mid: 1, value: -100),
+            DicdataElement(word: "阿", ruby: "あ", lcid: 10, rcid: 10, mid: 2, value: -90)
+        ]
+        let cmap = charMap(Array("あいか"))
+        try DictionaryBuilder.exportDictionary(entries: entries, to: userDir, baseName: "user", shardByFirstCharacter: false, char2UInt8: cmap)
+
+        let compiler = UserDictionaryCompiler(userDictionaryURL: userDir, char2UInt8: cmap)
+        let initial = compiler.snapshot
+        XCTAssertTrue(initial.overlay.isEmpty)
+        XCTAssertEqual(Set(initial.compiledEntries().map(\.word)), ["亜", "阿"])
+
+        // 1) 差分として適用した内容は直ちに参照できる
+        compiler.apply([
+            .add(DicdataElement(word: "愛", ruby: "あい", lcid: 10, rcid: 10, mid: 3, value: -80)),
+            .remove(ruby: "あ", word: "阿")
+        ])
+        let applied = compiler.snapshot
+        XCTAssertFalse(applied.overlay.isEmpty)
+        let (dicdata, availableMaxIndex) = applied.overlay.movingTowardPrefixSearch(chars: toIDs("あいか", cmap), depth: 0 ..< .max)
+        XCTAssertEqual(availableMaxIndex, 1)
+        XCTAssertEqual(dicdata[1]?.map(\.word), ["愛"])
+        XCTAssertTrue(dicdata[1]?.allSatisfy { $0.metadata.contains(.isFromUserDictionary) } ?? false)
+        XCTAssertEqual(applied.overlay.prefixMatch(chars: toIDs("あ", cmap)).map(\.word), ["愛"])
+        XCTAssertTrue(applied.overlay.isRemoved(entries[1]))
+        XCTAssertFalse(applied.overlay.isRemoved(entries[0]))
+        // 古い版は変更の影響を受けない
+        XCTAssertTrue(initial.overlay.isEmpty)
+
+        // 2) 統合すると差分が空になり、LOUDSとファイルに反映される
+        XCTAssertTrue(try compiler.compile())
+        XCTAssertFalse(try compiler.compile())
+        let compiled = compiler.snapshot
+        XCTAssertTrue(compiled.overlay.isEmpty)
+        XCTAssertEqual(Set(compiled.compiledEntries().map(\.word)), ["亜", "愛"])
+        guard let louds = compiled.louds, let index = louds.searchNodeIndex(chars: toIDs("あい", cmap)) else {
+            return XCTFail("searchNodeIndex failed for user ruby 'あい'")
+        }
+        let got = LOUDS.getUserDictionaryDataForLoudstxt3("user0", indices: [index & DictionaryBuilder.localMask], cache: compiled.loudstxt3[0], userDictionaryURL: userDir)
+        XCTAssertEqual(got.map(\.word), ["愛"])
+        // 統合した版は`user.current`が指すディレクトリに置かれ、ファイルから読み直しても同じ内容になる
+        let publishedURL = UserDictionaryCompiler.publishedDirectoryURL(in: userDir)
+        XCTAssertNotEqual(publishedURL.standardizedFileURL, userDir.standardizedFileURL)
+        XCTAssertNotNil(LOUDS.loadUserDictionary(userDictionaryURL: publishedURL))
+        let reloaded = UserDictionaryCompiler(userDictionaryURL: userDir, char2UInt8: cmap).snapshot
+        XCTAssertEqual(Set(reloaded.compiledEntries().map(\.word)), ["亜", "愛"])
+
+        // 3) 古い版は直前のものだけが残る
+        let versionsURL = userDir.appendingPathComponent(UserDictionaryCompiler.versionsDirectoryName, isDirectory: true)
+        for word in ["哀", "藍"] {
+            compiler.apply([.add(DicdataElement(word: word, ruby: "あい", lcid: 10, rcid: 10, mid: 3, value: -80))])
+            XCTAssertTrue(try compiler.compile())
+        }
+        XCTAssertEqual(try FileManager.default.contentsOfDirectory(atPath: versionsURL.path).count, 2)
+        let latest = UserDictionaryCompiler(userDictionaryURL: userDir, char2UInt8: cmap).snapshot
+        XCTAssertEqual(Set(latest.compiledEntries().map(\.word)), ["亜", "愛", "哀", "藍"])
+    }
+
+    // 複数のスレッドから連接確率を読み出しても、逐次に読み出した場合と同じ値になる
+    func testConcurrentCCValue() throws {
+        let formers = [0, 1285, CIDData.BOS.cid, 1285, 0]
+        let latters = Array(0 ..< 1319)
+        let expectedStore = DicdataStore(dictionaryURL: dictionaryMockURL)
+        let expected = formers.map { former in latters.map { expectedStore.getCCValue(former, $0) } }
+        // 存在しない行は既定値になる
+        XCTAssertTrue(expected[0].allSatisfy { $0 == -25 })
+
+        let store = DicdataStore(dictionaryURL: dictionaryMockURL)
+        var results = [[PValue]](repeating: [], count: formers.count)
+        results.withUnsafeMutableBufferPointer { results in
+            DispatchQueue.concurrentPerform(iterations: formers.count) { i in
+                // 変換器ごとのキャッシュを経由しても同じ値になる
+                let reader = store.makeConnectionCostReader()
+                results[i] = latters.map { i.isMultiple(of: 2) ? store.getCCValue(formers[i], $0) : reader.value(formers[i], $0) }
+            }
+        }
+        XCTAssertEqual(results, expected)
+    }
+
+    // 他のプロセスなどがユーザ辞書を書き換えた場合は読み込み直し、未統合の差分はそのまま残す
+    func testUserDictionaryCompilerReloadsWhenModified() throws {
+        let userDir = try tmpDir("user-reload")
+        defer {
+            try? FileManager.default.removeItem(at: userDir)
+        }
+        let cmap = charMap(Array("あいか"))
+        try DictionaryBuilder.exportDictionary(entries: [
+            DicdataElement(word: "亜", ruby: "あ", lcid: 10, rcid: 10, mid: 1, value: -100)
+        ], to: userDir, baseName: "user", shardByFirstCharacter: false, char2UInt8: cmap)
+
+        let compiler = UserDictionaryCompiler(userDictionaryURL: userDir, char2UInt8: cmap)
+        XCTAssertFalse(compiler.reloadIfModified())
+        compiler.apply([.add(DicdataElement(word: "愛", ruby: "あい", lcid: 10, rcid: 10, mid: 3, value: -80))])
+
+        // 別のコンパイラ（他のプロセスに相当する）が新しい版を書き出す
+        let other = UserDictionaryCompiler(userDictionaryURL: userDir, char2UInt8: cmap)
+        other.apply([.add(DicdataElement(word: "蚊", ruby: "か", lcid: 10, rcid: 10, mid: 4, value: -70))])
+        XCTAssertTrue(try other.compile())
+        XCTAssertEqual(Set(compiler.snapshot.compiledEntries().map(\.word)), ["亜"])
+
+        XCTAssertTrue(compiler.reloadIfModified())
+        XCTAssertEqual(Set(compiler.snapshot.compiledEntries().map(\.word)), ["亜", "蚊"])
+        XCTAssertEqual(compiler.snapshot.overlay.prefixMatch(chars: toIDs("あ", cmap)).map(\.word), ["愛"])
+
+        // 統合は最新の版に対して行われ、他が書き出した内容を上書きしない。自身の書き出しでは読み込み直さない
+        XCTAssertTrue(try compiler.compile())
+        XCTAssertEqual(Set(compiler.snapshot.compiledEntries().map(\.word)), ["亜", "愛", "蚊"])
+        XCTAssertFalse(compiler.reloadIfModified())
+        XCTAssertTrue(other.reloadIfModified())
+        XCTAssertEqual(Set(other.snapshot.compiledEntries().map(\.word)), ["亜", "愛", "蚊"])
+    }
+
+    // 同じユーザ辞書を指す状態の間ではコンパイラを共有し、差分も共有される
+    func testUserDictionaryCompilerIsSharedPerURL() throws {
+        let userDir = try tmpDir("user-shared")
+        defer {
+            try? FileManager.default.removeItem(at: userDir)
+        }
+        let store = DicdataStore(dictionaryURL: dictionaryMockURL)
+        let state1 = store.prepareState()
+        let state2 = store.prepareState()
+        state1.updateUserDictionaryURL(userDir)
+        state2.updateUserDictionaryURL(userDir)
+        XCTAssertTrue(state1.userDictionaryCompiler(in: store) === state2.userDictionaryCompiler(in: store))
+
+        store.applyUserDictionaryChanges([.remove(ruby: "ア", word: "亜")], state: state1)
+        XCTAssertEqual(state2.refreshUserDictionarySnapshot(in: store)?.overlay.isEmpty, false)
+
+        // 別のディレクトリを指す状態とは共有しない
+        let otherDir = try tmpDir("user-shared-other")
+        defer {
+            try? FileManager.default.removeItem(at: otherDir)
+        }
+        let state3 = store.prepareState()
+        state3.updateUserDictionaryURL(otherDir)
+        XCTAssertFalse(state1.userDictionaryCompiler(in: store) === state3.userDictionaryCompiler(in: store))
+        XCTAssertEqual(state3.refreshUserDictionarySnapshot(in: store)?.overlay.isEmpty, true)
+    }
+
+    func testDynamicUserDictionaryIndex() {
+        let dictionary = DynamicUserDictionary([
+            DicdataElement(word: "カスタム変換", ruby: "カスタムヘンカン", lcid: 10, rcid: 10, mid: 1, value: -12),
+            DicdataElement(word: "テスト単語", ruby: "テストタンゴ", lcid: 10, rcid: 10, mid: 1, value: -10),
+            DicdataElement(word: "かすたむ", ruby: "カスタム", lcid: 10, rcid: 10, mid: 1, value: -11),
+            DicdataElement(word: "テスト", ruby: "テストタンゴ", lcid: 10, rcid: 10, mid: 1, value: -9)
+        ])
+        XCTAssertFalse(dictionary.isEmpty)
+        XCTAssertTrue(DynamicUserDictionary().isEmpty)
+        // 結果は登録された順に返す
+        XCTAssertEqual(dictionary.match("テストタンゴ").map(\.word), ["テスト単語", "テスト"])
+        XCTAssertEqual(dictionary.match("テスト").map(\.word), [])
+        XCTAssertEqual(dictionary.prefixMatch("カスタム").map(\.word), ["カスタム変換", "かすたむ"])
+        XCTAssertEqual(dictionary.prefixMatch("カ").count, 2)
+        XCTAssertEqual(dictionary.prefixMatch("ア").count, 0)
+        XCTAssertEqual(dictionary.commonPrefixCount("テストダ"), 3)
+        XCTAssertEqual(dictionary.commonPrefixCount("カスタムヘンカンキ"), 8)
+        XCTAssertEqual(dictionary.commonPrefixCount("ン"), 0)
+    }
+
+    func testConcurrentLookupMatchesSerialLookup() throws {
+        let store = DicdataStore(dictionaryURL: dictionaryMockURL)
+        let state = store.prepareState()
+        var composingText = ComposingText()
+        composingText.insertAtCursorPosition("わたしはきのうからずっとあたらしいへんかんきのせっけいをかんがえています", inputStyle: .direct)
+        let ranges: [DicdataStore.LookupRange] = (0 ..< composingText.input.count).map { ((startIndex: $0, endIndexRange: nil), (startIndex: $0, endIndexRange: nil)) }
+        XCTAssertGreaterThanOrEqual(ranges.count, DicdataStore.concurrentLookupThreshold)
+
+        let concurrent = store.lookupDicdata(composingText: composingText, ranges: ranges, needTypoCorrection: false, state: state)
+        let serial = ranges.map {
+            store.lookupDicdata(composingText: composingText, inputRange: $0.inputRange, surfaceRange: $0.surfaceRange, needTypoCorrection: false, state: state)
+        }
+        // 開始位置ごとの結果は、並列に実行しても順序を含めて逐次の場合と一致する
+        XCTAssertEqual(concurrent.count, serial.count)
+        for (lhs, rhs) in zip(concurrent, serial) {
+            XCTAssertEqual(lhs.map(\.data), rhs.map(\.data))
+            XCTAssertEqual(lhs.map(\.range), rhs.map(\.range))
+        }
+    }
 }
@@ -159,6 +159,193 @@ final class DictionaryBuilderTests: XCTestCase {
         XCTAssertTrue(Set(words).isSuperset(of: ["愛", "藍"]))
     }
 
+    func testMappedLOUDSMatchesLegacyFormat() throws {
+        let parent = try tmpDir("mapped-louds")
+        defer {
+            try? FileManager.default.removeItem(at: parent)
+        }
+        let loudsDir = parent.appendingPathComponent("louds", isDirectory: true)
+        try FileManager.default.createDirectory(at: loudsDir, withIntermediateDirectories: true)
+
+        let entries = sampleEntries()
+        let chars: [Character] = Array(entries.flatMapSet { Array($0.ruby) }).sorted()
+        let cmap = charMap(chars)
+        try DictionaryBuilder.exportDictionary(
+            entries: entries,
+            to: loudsDir,
+            baseName: "ignored",
+            shardByFirstCharacter: true,
+            char2UInt8: cmap
+        )
+
+        let escapedA = DictionaryBuilder.escapedIdentifier("あ")
+        let mappedURL = loudsDir.appendingPathComponent("\(escapedA).loudsx")
+        assertExists(mappedURL)
+        guard let mapped = LOUDS.load(escapedA, dictionaryURL: parent) else {
+            return XCTFail("Failed to load mapped LOUDS for あ")
+        }
+        // Corrupted .loudsx must be rejected and fall back to .louds + .loudschars2
+        try Data("LOUDSX01".utf8).write(to: mappedURL)
+        guard let legacy = LOUDS.load(escapedA, dictionaryURL: parent) else {
+            return XCTFail("Failed to load legacy LOUDS for あ")
+        }
+        for key in ["あ", "あい", "い", "か", "あか"] {
+            let ids = toIDs(key, cmap)
+            XCTAssertEqual(mapped.searchNodeIndex(chars: ids), legacy.searchNodeIndex(chars: ids), key)
+            XCTAssertEqual(mapped.prefixNodeIndices(chars: ids, maxDepth: 2, maxCount: 10), legacy.prefixNodeIndices(chars: ids, maxDepth: 2, maxCount: 10), key)
+        }
+        XCTAssertNotNil(legacy.searchNodeIndex(chars: toIDs("あい", cmap)))
+    }
+
+    func testExportUnifiedDictionary_RoundTrip() throws {
+        let parent = try tmpDir("unified")
+        defer {
+            try? FileManager.default.removeItem(at: parent)
+        }
+        let loudsDir = parent.appendingPathComponent("louds", isDirectory: true)
+        try FileManager.default.createDirectory(at: loudsDir, withIntermediateDirectories: true)
+
+        let entries = sampleEntries()
+        let chars: [Character] = Array(entries.flatMapSet { Array($0.ruby) }).sorted()
+        let cmap = charMap(chars)
+        try DictionaryBuilder.exportUnifiedDictionary(entries: entries, to: loudsDir, char2UInt8: cmap)
+
+        let id = DictionaryBuilder.unifiedIdentifier
+        assertExists(loudsDir.appendingPathComponent("\(id).louds"))
+        assertExists(loudsDir.appendingPathComponent("\(id).loudsx"))
+        assertExists(loudsDir.appendingPathComponent("\(id)0.loudstxt3"))
+        // No per-first-character files are written
+        XCTAssertFalse(FileManager.default.fileExists(atPath: loudsDir.appendingPathComponent("[3042].louds").path))
+
+        // Any first character resolves to the same combined trie
+        let store = DicdataStore(dictionaryURL: parent)
+        let state = store.prepareState()
+        guard let loudsA = store.loadLOUDS(query: "あ", state: state),
+              let loudsKa = store.loadLOUDS(query: "か", state: state) else {
+            return XCTFail("Failed to load unified LOUDS via DicdataStore")
+        }
+        for (ruby, expected) in [("あい", ["愛", "藍"]), ("か", ["蚊"]), ("い", ["胃"])] {
+            guard let index = loudsA.searchNodeIndex(chars: toIDs(ruby, cmap)) else {
+                return XCTFail("searchNodeIndex failed for \(ruby)")
+            }
+            XCTAssertEqual(loudsKa.searchNodeIndex(chars: toIDs(ruby, cmap)), index)
+            let words = store.getDicdataFromLoudstxt3(identifier: String(ruby.first!), indices: [index], state: state)
+                .filter { $0.ruby == ruby }
+                .map { $0.word }
+            XCTAssertEqual(Set(words), Set(expected), ruby)
+        }
+    }
+
+    func testExportDictionaryConcurrently_ByteIdenticalToSerial() async throws {
+        let serialDir = try tmpDir("serial")
+        let concurrentDir = try tmpDir("concurrent")
+        defer {
+            try? FileManager.default.removeItem(at: serialDir)
+            try? FileManager.default.removeItem(at: concurrentDir)
+        }
+        let entries = sampleEntries() + [
+            DicdataElement(word: "会", ruby: "あう", lcid: 14, rcid: 14, mid: 7, value: -40),
+            DicdataElement(word: "か", ruby: "か", lcid: 15, rcid: 15, mid: 8, value: -45),
+            DicdataElement(word: "今日", ruby: "きょう", lcid: 16, rcid: 16, mid: 9, value: -30)
+        ]
+        let chars: [Character] = Array(entries.flatMapSet { Array($0.ruby) }).sorted()
+        let cmap = charMap(chars)
+        try DictionaryBuilder.exportDictionary(entries: entries, to: serialDir, baseName: "ignored", shardByFirstCharacter: true, char2UInt8: cmap)
+        let metrics = try await DictionaryBuilder.exportDictionaryConcurrently(entries: entries, to: concurrentDir, char2UInt8: cmap, maxConcurrency: 2)
+
+        let serialFiles = try FileManager.default.contentsOfDirectory(atPath: serialDir.path).sorted()
+        let concurrentFiles = try FileManager.default.contentsOfDirectory(atPath: concurrentDir.path).sorted()
+        XCTAssertEqual(serialFiles, concurrentFiles)
+        for name in serialFiles {
+            let serial = try Data(contentsOf: serialDir.appendingPathComponent(name))
+            let concurrent = try Data(contentsOf: concurrentDir.appendingPathComponent(name))
+            XCTAssertEqual(serial, concurrent, name)
+        }
+        XCTAssertEqual(metrics.trieCount, 4) // あ, い, か, き
+        XCTAssertEqual(metrics.entryCount, entries.count)
+        XCTAssertEqual(metrics.fileCount, serialFiles.count)
+    }
+
+    func testPredictionScoreIndexRanksPrefixCompletions() throws {
+        let parent = try tmpDir("prediction-score")
+        defer {
+            try? FileManager.default.removeItem(at: parent)
+        }
+        let loudsDir = parent.appendingPathComponent("louds", isDirectory: true)
+        try FileManager.default.createDirectory(at: loudsDir, withIntermediateDirectories: true)
+
+        // rcid 33 (連用タ接続) is not usable for prediction
+        let entries: [DicdataElement] = [
+            DicdataElement(word: "亜", ruby: "あ", lcid: 10, rcid: 10, mid: 1, value: -10),
+            DicdataElement(word: "愛", ruby: "あい", lcid: 10, rcid: 10, mid: 1, value: -8),
+            DicdataElement(word: "藍", ruby: "あい", lcid: 10, rcid: 10, mid: 1, value: -12),
+            DicdataElement(word: "赤", ruby: "あか", lcid: 10, rcid: 10, mid: 1, value: -6),
+            DicdataElement(word: "明か", ruby: "あか", lcid: 33, rcid: 33, mid: 1, value: -1),
+            DicdataElement(word: "赤い", ruby: "あかい", lcid: 10, rcid: 10, mid: 1, value: -5),
+            DicdataElement(word: "開く", ruby: "あく", lcid: 33, rcid: 33, mid: 1, value: -2),
+            DicdataElement(word: "紅い", ruby: "あかいい", lcid: 10, rcid: 10, mid: 1, value: -4)
+        ]
+        let cmap = charMap(Array(entries.flatMapSet { Array($0.ruby) }).sorted())
+        try DictionaryBuilder.exportDictionary(entries: entries, to: loudsDir, baseName: "ignored", shardByFirstCharacter: true, char2UInt8: cmap)
+
+        let id = DictionaryBuilder.escapedIdentifier("あ")
+        assertExists(loudsDir.appendingPathComponent("\(id).\(PredictionScoreIndex.fileExtension)"))
+        guard let louds = LOUDS.load(id, dictionaryURL: parent),
+              let scoreIndex = PredictionScoreIndex.load(id, dictionaryURL: parent),
+              let root = louds.searchNodeIndex(chars: toIDs("あ", cmap)) else {
+            return XCTFail("Failed to load prediction score index for あ")
+        }
+        XCTAssertEqual(scoreIndex.nodeCount, louds.nodeCount)
+        func node(_ ruby: String) -> Int? {
+            louds.searchNodeIndex(chars: toIDs(ruby, cmap))
+        }
+        // Ranked by the best usable score minus the per-character penalty; あく has no usable rows
+        // あか: -6 - 1, あい: -8 - 1, あかい: -5 - 2, あかいい: -4 - 3
+        let ranked = scoreIndex.bestNodeIndices(louds: louds, from: root, maxDepth: .max, maxCount: 10, depthPenalty: 1)
+        XCTAssertEqual(ranked, [node("あか"), node("あかい"), node("あかいい"), node("あい")].compactMap { $0 })
+        XCTAssertEqual(scoreIndex.bestNodeIndices(louds: louds, from: root, maxDepth: .max, maxCount: 2, depthPenalty: 1), Array(ranked.prefix(2)))
+        // maxDepth follows LOUDS.prefixNodeIndices: nodes up to maxDepth + 1 characters ahead
+        XCTAssertEqual(Set(scoreIndex.bestNodeIndices(louds: louds, from: root, maxDepth: 0, maxCount: 10, depthPenalty: 1)), Set([node("あか"), node("あい")].compactMap { $0 }))
+        // Every ranked node is also reachable by the unranked search
+        XCTAssertTrue(Set(ranked).isSubset(of: louds.prefixNodeIndices(chars: toIDs("あ", cmap), maxDepth: .max, maxCount: .max)))
+    }
+
+    func testExportConnectionCostMatrixMatchesRowFiles() throws {
+        let parent = try tmpDir("cc-matrix")
+        defer {
+            try? FileManager.default.removeItem(at: parent)
+        }
+        let mockURL = Bundle.module.resourceURL!.standardizedFileURL.appendingPathComponent("DictionaryMock", isDirectory: true)
+        try FileManager.default.copyItem(at: mockURL.appendingPathComponent("cb", isDirectory: true), to: parent.appendingPathComponent("cb", isDirectory: true))
+        try DictionaryBuilder.exportConnectionCostMatrix(dictionaryURL: parent)
+        assertExists(parent.appendingPathComponent("cb/\(ConnectionCostMatrix.fileName)"))
+        XCTAssertNotNil(ConnectionCostMatrix.load(dictionaryURL: parent))
+
+        // The mapped matrix must give the same costs as the lazily loaded row files
+        let matrixStore = DicdataStore(dictionaryURL: parent)
+        let rowStore = DicdataStore(dictionaryURL: mockURL)
+        for former in [0, 1285, 1318] {
+            let latter = matrixStore.getCCLatter(former)
+            for index in 0 ..< matrixStore.connectionCostRowCount {
+                XCTAssertEqual(matrixStore.getCCValue(former, index), rowStore.getCCValue(former, index), "\(former), \(index)")
+                XCTAssertEqual(latter.get(index), rowStore.getCCValue(former, index), "\(former), \(index)")
+            }
+            // Batched lookups agree with the per-element lookups for both backings
+            let latters: [Int32] = [0, 5, 1285, Int32(matrixStore.connectionCostRowCount - 1), 5]
+            var matrixScores: [PValue] = []
+            var rowScores: [PValue] = [1, 2, 3, 4, 5, 6, 7]
+            latter.gather(latters, into: &matrixScores)
+            rowStore.getCCLatter(former).gather(latters, into: &rowScores)
+            let expected = latters.map { rowStore.getCCValue(former, Int($0)) }
+            XCTAssertEqual(Array(matrixScores.prefix(latters.count)), expected)
+            XCTAssertEqual(Array(rowScores.prefix(latters.count)), expected)
+        }
+
+        // A corrupted matrix is ignored
+        try Data("CCMATRX0".utf8).write(to: parent.appendingPathComponent("cb/\(ConnectionCostMatrix.fileName)"))
+        XCTAssertNil(ConnectionCostMatrix.load(dictionaryURL: parent))
+    }
+
     func testLoudstxt3BuilderBinaryParseConsistency() throws {
         // Directly exercise Loudstxt3Builder.makeBinary + LOUDS.parseBinary
         let groups: [(ruby: String, rows: [Loudstxt3Builder.Row])] = [
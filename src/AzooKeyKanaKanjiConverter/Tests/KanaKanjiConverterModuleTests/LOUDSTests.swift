@@ -45,4 +45,17 @@ final class LOUDSTests: XCTestCase {
         XCTAssertTrue(dicdata.contains {$0.word == "視界"})
         XCTAssertTrue(dicdata.contains {$0.word == "死界"})
     }
+
+    func testChildNodeIndicesMatchesBinarySearch() throws {
+        let louds = LOUDS.load("シ", dictionaryURL: Self.resourceURL)
+        XCTAssertNotNil(louds)
+        guard let louds else { return }
+        // ルートを含むすべてのノードについて、select索引を用いた結果が従来の実装と一致することを確かめる
+        let nodeIndices = [1] + louds.prefixNodeIndices(chars: [], maxDepth: .max, maxCount: .max)
+        XCTAssertGreaterThan(nodeIndices.count, 1)
+        for nodeIndex in nodeIndices {
+            XCTAssertEqual(louds.childNodeIndices(from: nodeIndex), louds.childNodeIndicesByBinarySearch(from: nodeIndex), "nodeIndex: \(nodeIndex)")
+        }
+        XCTAssertEqual(louds.childNodeIndices(from: 0), 0 ..< 0)
+    }
 }
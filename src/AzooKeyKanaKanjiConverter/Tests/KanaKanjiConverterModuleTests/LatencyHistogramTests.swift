@@ -0,0 +1,43 @@
+//
+//  LatencyHistogramTests.swift
+//  KanaKanjiConverterModuleTests
+//
+
+@testable import KanaKanjiConverterModule
+import XCTest
+
+final class LatencyHistogramTests: XCTestCase {
+    func testEmpty() throws {
+        let histogram = LatencyHistogram()
+        let snapshot = histogram.snapshot()
+        XCTAssertEqual(snapshot.count, 0)
+        XCTAssertEqual(snapshot.p50Nanoseconds, 0)
+        XCTAssertEqual(snapshot.p99Nanoseconds, 0)
+    }
+
+    func testPercentiles() throws {
+        let histogram = LatencyHistogram()
+        for i in 1 ... 100 {
+            histogram.record(nanoseconds: UInt64(i * 1000))
+        }
+        let snapshot = histogram.snapshot()
+        XCTAssertEqual(snapshot.count, 100)
+        XCTAssertEqual(snapshot.totalNanoseconds, 5_050_000)
+        XCTAssertEqual(snapshot.maxNanoseconds, 100_000)
+        // パーセンタイルはバケットの上限で近似される(誤差は最大で約19%)
+        XCTAssertGreaterThanOrEqual(snapshot.p50Nanoseconds, 50_000)
+        XCTAssertLessThanOrEqual(snapshot.p50Nanoseconds, 59_500)
+        XCTAssertGreaterThanOrEqual(snapshot.p99Nanoseconds, 99_000)
+        XCTAssertLessThanOrEqual(snapshot.p99Nanoseconds, 100_000)
+    }
+
+    func testReset() throws {
+        let histogram = LatencyHistogram()
+        histogram.measure {
+            _ = (0 ..< 100).reduce(0, +)
+        }
+        XCTAssertEqual(histogram.snapshot().count, 1)
+        histogram.reset()
+        XCTAssertEqual(histogram.snapshot(), LatencyHistogram.Snapshot(count: 0, totalNanoseconds: 0, p50Nanoseconds: 0, p99Nanoseconds: 0, maxNanoseconds: 0))
+    }
+}
@@ -92,4 +92,78 @@ final class LatticeTests: XCTestCase {
             }
         }
     }
+
+    func testDualIndexMapMatchesComposingText() throws {
+        let cache = LatticeDualIndexMapCache()
+        var c = ComposingText()
+        for char in "kyounotenkihaharedesune" {
+            c.insertAtCursorPosition(String(char), inputStyle: .roman2kana)
+            let latticeDualIndexMap = LatticeDualIndexMap(c)
+            let map = c.inputIndexToSurfaceIndexMap()
+            for iIndex in 0 ... c.input.count {
+                XCTAssertEqual(latticeDualIndexMap.dualIndex(for: .input(iIndex)).surfaceIndex, map[iIndex])
+            }
+            for sIndex in 0 ... c.convertTarget.count {
+                let iIndex = latticeDualIndexMap.dualIndex(for: .surface(sIndex)).inputIndex
+                // surfaceの位置に対応するinputの位置のうち、最も前のもの
+                XCTAssertEqual(iIndex, map.filter { $0.value == sIndex }.keys.min())
+            }
+            // 末尾への追加で差分更新した対応表は、最初から構築したものと一致する
+            let cached = cache.indexMap(for: c)
+            XCTAssertEqual(
+                cached.indices(inputCount: c.input.count, surfaceCount: c.convertTarget.count),
+                latticeDualIndexMap.indices(inputCount: c.input.count, surfaceCount: c.convertTarget.count)
+            )
+        }
+        // 末尾以外が変わった場合は構築し直す
+        var d = ComposingText()
+        d.insertAtCursorPosition("tenki", inputStyle: .roman2kana)
+        XCTAssertEqual(cache.indexMap(for: d).dualIndex(for: .surface(2)), LatticeDualIndexMap(d).dualIndex(for: .surface(2)))
+        XCTAssertEqual(cache.indexMap(for: d).dualIndex(for: .input(5)), .bothIndex(inputIndex: 5, surfaceIndex: 3))
+    }
+
+    func testNBestBuffer() throws {
+        var buffer = NBestBuffer<String>(capacity: 3)
+        XCTAssertTrue(buffer.insert("a", value: -5))
+        XCTAssertTrue(buffer.insert("b", value: -3))
+        XCTAssertTrue(buffer.insert("c", value: -5))
+        // スコアが等しい場合は先に挿入されたものが前に来る
+        XCTAssertEqual(buffer.elements, ["b", "a", "c"])
+        XCTAssertTrue(buffer.insert("d", value: -4))
+        XCTAssertEqual(buffer.elements, ["b", "d", "a"])
+        XCTAssertEqual(buffer.values, [-3, -4, -5])
+        // 上位に入らない要素は評価されない
+        XCTAssertFalse(buffer.insert({ XCTFail("should not be evaluated"); return "e" }(), value: -5))
+        buffer.removeAll()
+        XCTAssertTrue(buffer.isEmpty)
+        var empty = NBestBuffer<String>(capacity: 0)
+        XCTAssertFalse(empty.insert("a", value: 0))
+    }
+
+    func testLatticeNodePendingPaths() throws {
+        let arena = LatticeArena()
+        let source = LatticeNode(data: DicdataElement(word: "我輩", ruby: "ワガハイ", cid: CIDData.一般名詞.cid, mid: 1, value: -5), range: .input(from: 0, to: 4))
+        source.prevs = [
+            RegisteredNode(data: DicdataElement(word: "a", ruby: "a", cid: CIDData.BOS.cid, mid: 0, value: 0), registered: nil, totalValue: -1, range: .zero),
+            RegisteredNode(data: DicdataElement(word: "b", ruby: "b", cid: CIDData.BOS.cid, mid: 0, value: 0), registered: nil, totalValue: -2, range: .zero),
+            RegisteredNode(data: DicdataElement(word: "c", ruby: "c", cid: CIDData.BOS.cid, mid: 0, value: 0), registered: nil, totalValue: -3, range: .zero)
+        ]
+        let node = LatticeNode(data: DicdataElement(word: "は", ruby: "ハ", cid: CIDData.係助詞ハ.cid, mid: 2, value: -2), range: .input(from: 4, to: 5))
+        node.prevs = [RegisteredNode(data: DicdataElement(word: "x", ruby: "x", cid: CIDData.BOS.cid, mid: 0, value: 0), registered: nil, totalValue: -12, range: .zero)]
+        node.addPendingPath(from: source, index: 2, value: -13, nBest: 2, arena: arena)
+        node.addPendingPath(from: source, index: 0, value: -11, nBest: 2, arena: arena)
+        node.addPendingPath(from: source, index: 1, value: -12, nBest: 2, arena: arena)
+        // 参照されるまでノードは作成されない
+        XCTAssertEqual(arena.count, 0)
+        // 既存の経路と統合され、上位2件だけが残る。スコアが等しい場合は既存の経路が優先される
+        XCTAssertEqual(node.prevs.map(\.totalValue), [-11, -12])
+        XCTAssertEqual(node.prevs.map(\.data.word), ["我輩", "x"])
+        XCTAssertEqual(node.prevs[0].prev?.data.word, "a")
+        XCTAssertEqual(arena.count, 1)
+
+        node.addPendingPath(from: source, index: 0, value: -1, nBest: 2, arena: arena)
+        node.removeAllPrevs()
+        XCTAssertTrue(node.prevs.isEmpty)
+        XCTAssertEqual(arena.count, 1)
+    }
 }
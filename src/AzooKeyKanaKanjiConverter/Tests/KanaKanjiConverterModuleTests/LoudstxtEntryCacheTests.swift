@@ -0,0 +1,51 @@
+//
+//  LoudstxtEntryCacheTests.swift
+//  KanaKanjiConverterModuleTests
+//
+
+@testable import KanaKanjiConverterModule
+import XCTest
+
+final class LoudstxtEntryCacheTests: XCTestCase {
+    static let resourceURL = Bundle.module.resourceURL!.standardizedFileURL.appendingPathComponent("DictionaryMock", isDirectory: true)
+
+    private func entry(_ word: String) -> [DicdataElement] {
+        [DicdataElement(word: word, ruby: "テスト", cid: 0, mid: 0, value: -10)]
+    }
+
+    func testEvictsLeastRecentlyUsed() throws {
+        let cache = LoudstxtEntryCache(capacity: 2)
+        cache.insert(entry("a"), for: .init(identifier: "x", nodeIndex: 1))
+        cache.insert(entry("b"), for: .init(identifier: "x", nodeIndex: 2))
+        // 1を参照して最近使われたものにする
+        XCTAssertEqual(cache.value(for: .init(identifier: "x", nodeIndex: 1))?.first?.word, "a")
+        cache.insert(entry("c"), for: .init(identifier: "x", nodeIndex: 3))
+        XCTAssertNil(cache.value(for: .init(identifier: "x", nodeIndex: 2)))
+        XCTAssertEqual(cache.value(for: .init(identifier: "x", nodeIndex: 1))?.first?.word, "a")
+        XCTAssertEqual(cache.value(for: .init(identifier: "x", nodeIndex: 3))?.first?.word, "c")
+        // 識別子が異なれば別のエントリとして扱う
+        XCTAssertNil(cache.value(for: .init(identifier: "y", nodeIndex: 1)))
+
+        let statistics = cache.statistics
+        XCTAssertEqual(statistics.hits, 3)
+        XCTAssertEqual(statistics.misses, 2)
+        XCTAssertEqual(statistics.count, 2)
+    }
+
+    func testDicdataStoreServesRepeatedLookupsFromCache() throws {
+        let store = DicdataStore(dictionaryURL: Self.resourceURL)
+        let state = store.prepareState()
+        let charIDs = "シカイ".map(store.character2charId)
+        let indices = store.perfectMatchingSearch(query: "シ", charIDs: charIDs, state: state)
+        XCTAssertFalse(indices.isEmpty)
+
+        let first = store.getDicdataFromLoudstxt3(identifier: "シ", indices: indices, state: state)
+        XCTAssertEqual(store.loudstxtCacheStatistics().hits, 0)
+        FileAccessCounter.reset()
+        let second = store.getDicdataFromLoudstxt3(identifier: "シ", indices: indices, state: state)
+        XCTAssertEqual(FileAccessCounter.count, 0)
+        XCTAssertEqual(second.map(\.word), first.map(\.word))
+        XCTAssertTrue(second.contains { $0.word == "司会" })
+        XCTAssertEqual(store.loudstxtCacheStatistics().hits, indices.count)
+    }
+}
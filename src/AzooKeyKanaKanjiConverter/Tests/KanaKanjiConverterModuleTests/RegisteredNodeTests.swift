@@ -75,4 +75,40 @@ final class RegisteredNodeTests: XCTestCase {
         XCTAssertEqual(result.clauses.map {$0.value}, expectedResult.clauses.map {$0.value})
         XCTAssertEqual(result.clauses.map {$0.clause}, expectedResult.clauses.map {$0.clause})
     }
+
+    func testLatticeArena() throws {
+        let arena = LatticeArena()
+        let bos = RegisteredNode.BOSNode()
+        let node1 = arena.makeNode(
+            data: DicdataElement(word: "我輩", ruby: "ワガハイ", cid: CIDData.一般名詞.cid, mid: 1, value: -5),
+            registered: bos,
+            totalValue: -10,
+            range: .input(from: 0, to: 4)
+        )
+        let node2 = arena.makeNode(
+            data: DicdataElement(word: "は", ruby: "ハ", cid: CIDData.係助詞ハ.cid, mid: 2, value: -2),
+            registered: node1,
+            totalValue: -13,
+            range: .input(from: 4, to: 5)
+        )
+        XCTAssertEqual(arena.count, 2)
+        XCTAssertEqual(node2.prev?.data.word, "我輩")
+        XCTAssertEqual(node2.prev?.prev?.data.rcid, CIDData.BOS.cid)
+        XCTAssertNil(node2.prev?.prev?.prev)
+        XCTAssertEqual(node2.totalValue, -13)
+        XCTAssertEqual(node2.range, .input(from: 4, to: 5))
+
+        // 参照が残っているノードはリセット後も有効
+        arena.reset()
+        XCTAssertEqual(arena.count, 0)
+        let node3 = arena.makeNode(
+            data: DicdataElement(word: "猫", ruby: "ネコ", cid: CIDData.一般名詞.cid, mid: 3, value: -4),
+            registered: node2,
+            totalValue: -20,
+            range: .input(from: 5, to: 7)
+        )
+        XCTAssertEqual(node3.getCandidateData().data.map(\.word), ["我輩", "は", "猫"])
+        XCTAssertEqual(node2.getCandidateData().data.map(\.word), ["我輩", "は"])
+        XCTAssertEqual(arena.count, 1)
+    }
 }
@@ -1,47 +1,65 @@
 import Foundation
 import KanaKanjiConverterModuleWithDefaultDictionary
+import ffi
 
 // MARK: - Using KanaKanjiConverterModuleWithDefaultDictionary with patched AzooKey v0.11.1
 
 // MARK: - Global State
 // Note: nonisolated(unsafe) is used for global mutable state accessed from exported C functions
-nonisolated(unsafe) private var converter: KanaKanjiConverter?
-nonisolated(unsafe) private var composingText = ComposingText()
-nonisolated(unsafe) private var currentCandidates: [Candidate] = []
-nonisolated(unsafe) private var config = EngineConfig()
-
-/// Engine configuration
-struct EngineConfig {
-    var dictionaryPath: String = ""
-    var memoryPath: String = ""
-    var zenzaiEnabled: Bool = false
-    var zenzaiInferenceLimit: Int = 10
-    var zenzaiWeightPath: String = ""
-}
-
-/// Get conversion options
-private func getOptions() -> ConvertRequestOptions {
-    var zenzaiMode: ConvertRequestOptions.ZenzaiMode = .off
-
-    if config.zenzaiEnabled, !config.zenzaiWeightPath.isEmpty {
-        let weightURL = URL(fileURLWithPath: config.zenzaiWeightPath)
-        zenzaiMode = .on(weight: weightURL, inferenceLimit: config.zenzaiInferenceLimit, personalizationMode: nil)
+/// Engine behind the handle-less API (one input context per process).
+/// Hosts serving several contexts use the azookey_* handle API instead.
+nonisolated(unsafe) private let defaultEngine = Engine()
+
+/// Time spent inside the exported functions, conversion included
+private let ffiLatency = LatencyHistogram()
+
+/// Run `body` on the default engine while holding its lock
+private func withDefaultEngine<R>(_ body: () -> R) -> R {
+    ffiLatency.measure {
+        defaultEngine.lock.withLock(body)
     }
+}
+
+/// Engine behind an azookey_engine_t* handle
+private func resolveEngine(_ handle: OpaquePointer?) -> Engine? {
+    guard let handle = handle else { return nil }
+    return Unmanaged<Engine>.fromOpaque(UnsafeRawPointer(handle)).takeUnretainedValue()
+}
 
-    let memoryURL = config.memoryPath.isEmpty ? nil : URL(fileURLWithPath: config.memoryPath)
+/// Run `body` on the engine behind `handle` while holding its lock.
+/// Edits pass `isEdit: true` to cancel a pending asynchronous conversion first.
+@discardableResult
+private func withEngine<R>(_ handle: OpaquePointer?, isEdit: Bool = false, _ body: (Engine) -> R) -> R? {
+    guard let engine = resolveEngine(handle) else { return nil }
+    return ffiLatency.measure {
+        if isEdit {
+            engine.cancelConversion()
+        }
+        return engine.lock.withLock { body(engine) }
+    }
+}
+
+/// C callback and its user data, handed to the conversion worker
+private struct ConversionDelivery: @unchecked Sendable {
+    let callback: ConversionCallback
+    let userData: UnsafeMutableRawPointer?
+}
+
+/// Parse a config JSON object from raw bytes
+private func parseConfig(_ data: Data) -> [String: Any]? {
+    try? JSONSerialization.jsonObject(with: data) as? [String: Any]
+}
+
+/// Candidate texts as a JSON array (legacy string API)
+private func candidatesJSON(_ cache: ConversionCache) -> UnsafePointer<CChar>? {
+    let candidateTexts = cache.candidates.map { $0.text }
+
+    guard let jsonData = try? JSONSerialization.data(withJSONObject: candidateTexts),
+          let jsonString = String(data: jsonData, encoding: .utf8) else {
+        return UnsafePointer(_strdup("[]"))
+    }
 
-    return ConvertRequestOptions(
-        requireJapanesePrediction: true,
-        requireEnglishPrediction: false,
-        keyboardLanguage: .ja_JP,
-        learningType: memoryURL != nil ? .inputAndOutput : .nothing,
-        memoryDirectoryURL: memoryURL ?? URL(fileURLWithPath: NSTemporaryDirectory()),
-        sharedContainerURL: memoryURL ?? URL(fileURLWithPath: NSTemporaryDirectory()),
-        textReplacer: TextReplacer.withDefaultEmojiDictionary(),
-        specialCandidateProviders: nil,
-        zenzaiMode: zenzaiMode,
-        metadata: nil
-    )
+    return UnsafePointer(_strdup(jsonString))
 }
 
 // MARK: - Exported Functions
@@ -53,142 +71,132 @@ public func loadConfig(_ configPath: UnsafePointer<CChar>?) {
 
     // Load config from JSON file
     guard let data = FileManager.default.contents(atPath: path),
-          let json = try? JSONSerialization.jsonObject(with: data) as? [String: Any] else {
+          let json = parseConfig(data) else {
         return
     }
-
-    if let dictPath = json["dictionaryPath"] as? String {
-        config.dictionaryPath = dictPath
-    }
-    if let memPath = json["memoryPath"] as? String {
-        config.memoryPath = memPath
-    }
-    if let zenzaiEnabled = json["zenzaiEnabled"] as? Bool {
-        config.zenzaiEnabled = zenzaiEnabled
-    }
-    if let zenzaiLimit = json["zenzaiInferenceLimit"] as? Int {
-        config.zenzaiInferenceLimit = zenzaiLimit
-    }
-    if let zenzaiWeight = json["zenzaiWeightPath"] as? String {
-        config.zenzaiWeightPath = zenzaiWeight
+    withDefaultEngine {
+        defaultEngine.loadConfig(json)
     }
 }
 
 @_silgen_name("Initialize")
 public func initialize(_ dictionaryPath: UnsafePointer<CChar>?, _ memoryPath: UnsafePointer<CChar>?) {
-    if let dictPath = dictionaryPath {
-        config.dictionaryPath = String(cString: dictPath)
-    }
-    if let memPath = memoryPath {
-        config.memoryPath = String(cString: memPath)
-    }
-
-    // Initialize converter with dictionary
-    if config.dictionaryPath.isEmpty {
-        converter = KanaKanjiConverter.withDefaultDictionary()
-    } else {
-        let dictURL = URL(fileURLWithPath: config.dictionaryPath)
-        let dicdataStore = DicdataStore(dictionaryURL: dictURL)
-        converter = KanaKanjiConverter(dicdataStore: dicdataStore)
+    let dictPath = dictionaryPath.map { String(cString: $0) }
+    let memPath = memoryPath.map { String(cString: $0) }
+    withDefaultEngine {
+        defaultEngine.initialize(dictionaryPath: dictPath, memoryPath: memPath)
     }
-
-    composingText = ComposingText()
-    currentCandidates = []
 }
 
 @_silgen_name("Shutdown")
 public func shutdown() {
-    converter = nil
-    composingText = ComposingText()
-    currentCandidates = []
+    withDefaultEngine {
+        defaultEngine.shutdown()
+    }
 }
 
 @_silgen_name("AppendText")
 public func appendText(_ input: UnsafePointer<CChar>?) {
     guard let input = input else { return }
     let inputString = String(cString: input)
-    // Use .direct for hiragana input from Mozc (not roman2kana)
-    composingText.insertAtCursorPosition(inputString, inputStyle: .direct)
+    withDefaultEngine {
+        defaultEngine.appendText(inputString)
+    }
 }
 
 @_silgen_name("RemoveText")
 public func removeText(_ count: Int32) {
-    for _ in 0..<count {
-        composingText.deleteBackwardFromCursorPosition(count: 1)
+    withDefaultEngine {
+        defaultEngine.removeText(Int(count))
     }
 }
 
 @_silgen_name("MoveCursor")
 public func moveCursor(_ offset: Int32) {
-    if offset > 0 {
-        for _ in 0..<offset {
-            _ = composingText.moveCursorFromCursorPosition(count: 1)
-        }
-    } else if offset < 0 {
-        for _ in 0..<(-offset) {
-            _ = composingText.moveCursorFromCursorPosition(count: -1)
-        }
+    withDefaultEngine {
+        defaultEngine.moveCursor(Int(offset))
     }
 }
 
 @_silgen_name("ClearText")
 public func clearText() {
-    composingText = ComposingText()
-    currentCandidates = []
+    withDefaultEngine {
+        defaultEngine.clearText()
+    }
 }
 
-@_silgen_name("GetComposedText")
-public func getComposedText() -> UnsafePointer<CChar>? {
-    guard let conv = converter else { return nil }
-
-    let result = conv.requestCandidates(composingText, options: getOptions())
-    currentCandidates = result.mainResults
+@_cdecl("ApplyEdits")
+public func applyEdits(_ ops: UnsafePointer<EditOp>?, _ count: Int32, _ out: UnsafeMutablePointer<ConversionResultView>?) -> Bool {
+    let buffer = UnsafeBufferPointer(start: ops, count: ops == nil ? 0 : max(Int(count), 0))
+    return withDefaultEngine {
+        defaultEngine.applyEdits(buffer)
+        guard let out = out else { return true }
+        guard let cache = defaultEngine.ensureConverted() else { return false }
+        cache.fill(&out.pointee)
+        return true
+    }
+}
 
-    // Return best candidate
-    guard let first = currentCandidates.first else {
-        return UnsafePointer(_strdup(""))
+@_cdecl("Convert")
+public func convert(_ out: UnsafeMutablePointer<ConversionResultView>?) -> Bool {
+    guard let out = out else { return false }
+    return withDefaultEngine {
+        guard let cache = defaultEngine.ensureConverted() else { return false }
+        cache.fill(&out.pointee)
+        return true
     }
+}
 
-    return UnsafePointer(_strdup(first.text))
+@_silgen_name("GetComposedText")
+public func getComposedText() -> UnsafePointer<CChar>? {
+    withDefaultEngine {
+        guard let cache = defaultEngine.ensureConverted() else { return nil }
+        // Return best candidate
+        return UnsafePointer(_strdup(cache.candidates.first?.text ?? ""))
+    }
 }
 
 @_silgen_name("GetCandidates")
 public func getCandidates() -> UnsafePointer<CChar>? {
-    guard let conv = converter else { return nil }
-
-    let result = conv.requestCandidates(composingText, options: getOptions())
-    currentCandidates = result.mainResults
-
-    // Return candidates as JSON array
-    let candidateTexts = currentCandidates.map { $0.text }
+    withDefaultEngine {
+        guard let cache = defaultEngine.ensureAllCandidates() else { return nil }
+        return candidatesJSON(cache)
+    }
+}
 
-    guard let jsonData = try? JSONSerialization.data(withJSONObject: candidateTexts),
-          let jsonString = String(data: jsonData, encoding: .utf8) else {
-        return UnsafePointer(_strdup("[]"))
+@_cdecl("GetCandidateBuffer")
+public func getCandidateBuffer(_ version: UInt32, _ out: UnsafeMutablePointer<CandidateBufferView>?) -> Bool {
+    guard let out = out, version == UInt32(CANDIDATE_BUFFER_VERSION) else { return false }
+    return withDefaultEngine {
+        guard let cache = defaultEngine.ensureAllCandidates() else { return false }
+        cache.fill(&out.pointee)
+        return true
     }
+}
 
-    return UnsafePointer(_strdup(jsonString))
+@_cdecl("GetCandidatePage")
+public func getCandidatePage(_ offset: Int32, _ count: Int32, _ out: UnsafeMutablePointer<CandidateBufferView>?, _ hasMore: UnsafeMutablePointer<Bool>?) -> Bool {
+    guard let out = out else { return false }
+    return withDefaultEngine {
+        guard let cache = defaultEngine.ensureCandidates(upTo: Int(offset) + Int(count)) else { return false }
+        let more = cache.fillPage(offset: Int(offset), count: Int(count), &out.pointee)
+        hasMore?.pointee = more
+        return true
+    }
 }
 
 @_silgen_name("SelectCandidate")
 public func selectCandidate(_ index: Int32) {
-    guard index >= 0, index < currentCandidates.count else { return }
-
-    let selected = currentCandidates[Int(index)]
-
-    // Apply the selected candidate
-    if let conv = converter {
-        conv.setCompletedData(selected)
+    withDefaultEngine {
+        defaultEngine.selectCandidate(Int(index))
     }
-
-    // Clear composing text after selection
-    composingText = ComposingText()
-    currentCandidates = []
 }
 
 @_silgen_name("ShrinkText")
 public func shrinkText() {
-    composingText.deleteForwardFromCursorPosition(count: 1)
+    withDefaultEngine {
+        defaultEngine.shrinkText()
+    }
 }
 
 @_silgen_name("ExpandText")
@@ -203,12 +211,78 @@ public func setContext(_ precedingText: UnsafePointer<CChar>?) {
 
 @_silgen_name("SetZenzaiEnabled")
 public func setZenzaiEnabled(_ enabled: Bool) {
-    config.zenzaiEnabled = enabled
+    withDefaultEngine {
+        defaultEngine.setZenzaiEnabled(enabled)
+    }
 }
 
 @_silgen_name("SetZenzaiInferenceLimit")
 public func setZenzaiInferenceLimit(_ limit: Int32) {
-    config.zenzaiInferenceLimit = Int(limit)
+    withDefaultEngine {
+        defaultEngine.setZenzaiInferenceLimit(Int(limit))
+    }
+}
+
+@_cdecl("WarmUp")
+public func warmUp(_ flags: UInt32) -> Bool {
+    defaultEngine.warmUp(flags: flags)
+}
+
+@_cdecl("GetWarmUpProgress")
+public func getWarmUpProgress(_ out: UnsafeMutablePointer<WarmUpProgress>?) -> Bool {
+    guard let out = out else { return false }
+    let progress = defaultEngine.warmUpProgress
+    out.pointee = WarmUpProgress(completed: Int32(progress.completed), total: Int32(progress.total), running: progress.running)
+    return true
+}
+
+@_cdecl("GetEngineStats")
+public func getEngineStats(_ out: UnsafeMutablePointer<EngineStats>?) -> Bool {
+    guard let out = out else { return false }
+    let histograms: [LatencyHistogram] = [
+        ConversionStatistics.requestCandidates,
+        ConversionStatistics.lookupDicdata,
+        ConversionStatistics.latticeConstruction,
+        ConversionStatistics.zenzaiDecode,
+        ffiLatency,
+    ]
+    withUnsafeMutablePointer(to: &out.pointee.stages) { tuple in
+        tuple.withMemoryRebound(to: StageStats.self, capacity: Int(ENGINE_STAGE_COUNT)) { stages in
+            for (i, histogram) in histograms.enumerated() where i < Int(ENGINE_STAGE_COUNT) {
+                let snapshot = histogram.snapshot()
+                stages[i] = StageStats(
+                    count: snapshot.count,
+                    totalNs: snapshot.totalNanoseconds,
+                    p50Ns: snapshot.p50Nanoseconds,
+                    p99Ns: snapshot.p99Nanoseconds,
+                    maxNs: snapshot.maxNanoseconds
+                )
+            }
+        }
+    }
+    out.pointee.fileAccessCount = Int64(FileAccessCounter.count)
+    let cacheStatistics = SharedResources.dictionaryCacheStatistics()
+    out.pointee.dictionaryCacheHits = Int64(cacheStatistics.hits)
+    out.pointee.dictionaryCacheMisses = Int64(cacheStatistics.misses)
+    return true
+}
+
+@_cdecl("ResetEngineStats")
+public func resetEngineStats() {
+    ConversionStatistics.reset()
+    ffiLatency.reset()
+    FileAccessCounter.reset()
+    SharedResources.resetDictionaryCacheStatistics()
+}
+
+@_cdecl("GetFileAccessCount")
+public func getFileAccessCount() -> Int64 {
+    Int64(FileAccessCounter.count)
+}
+
+@_cdecl("ResetFileAccessCount")
+public func resetFileAccessCount() {
+    FileAccessCounter.reset()
 }
 
 @_silgen_name("FreeString")
@@ -217,62 +291,166 @@ public func freeString(_ str: UnsafePointer<CChar>?) {
     free(UnsafeMutablePointer(mutating: str))
 }
 
-// MARK: - Test API wrapper functions
+// MARK: - Handle API
 
 @_cdecl("azookey_create")
-public func azookey_create(_ configJson: UnsafePointer<CChar>?) -> UnsafeMutableRawPointer? {
+public func azookey_create(_ configJson: UnsafePointer<CChar>?) -> OpaquePointer? {
     guard let configJson = configJson else { return nil }
-    
-    let jsonString = String(cString: configJson)
-    
+
     // Parse JSON configuration
-    guard let jsonData = jsonString.data(using: .utf8),
-          let json = try? JSONSerialization.jsonObject(with: jsonData) as? [String: Any] else {
+    guard let json = parseConfig(Data(String(cString: configJson).utf8)) else {
         return nil
     }
-    
-    // Update configuration
-    if let dictPath = json["dictionaryPath"] as? String {
-        config.dictionaryPath = dictPath
-    }
-    if let memPath = json["memoryPath"] as? String {
-        config.memoryPath = memPath
-    }
-    if let zenzaiEnabled = json["zenzaiEnabled"] as? Bool {
-        config.zenzaiEnabled = zenzaiEnabled
-    }
-    if let zenzaiLimit = json["zenzaiInferenceLimit"] as? Int {
-        config.zenzaiInferenceLimit = zenzaiLimit
+
+    var config = EngineConfig()
+    config.apply(json)
+    let engine = Engine(config: config)
+    engine.initialize(dictionaryPath: nil, memoryPath: nil)
+
+    return OpaquePointer(Unmanaged.passRetained(engine).toOpaque())
+}
+
+@_cdecl("azookey_destroy")
+public func azookey_destroy(_ engine: OpaquePointer?) {
+    guard let engine = engine else { return }
+    let unmanaged = Unmanaged<Engine>.fromOpaque(UnsafeRawPointer(engine))
+    unmanaged.takeUnretainedValue().cancelConversion()
+    unmanaged.takeUnretainedValue().lock.withLock {
+        unmanaged.takeUnretainedValue().shutdown()
     }
-    if let zenzaiWeight = json["zenzaiWeightPath"] as? String {
-        config.zenzaiWeightPath = zenzaiWeight
+    unmanaged.release()
+}
+
+@_cdecl("azookey_append_text")
+public func azookey_append_text(_ engine: OpaquePointer?, _ input: UnsafePointer<CChar>?) {
+    guard let input = input else { return }
+    let inputString = String(cString: input)
+    withEngine(engine, isEdit: true) { $0.appendText(inputString) }
+}
+
+@_cdecl("azookey_remove_text")
+public func azookey_remove_text(_ engine: OpaquePointer?, _ count: Int32) {
+    withEngine(engine, isEdit: true) { $0.removeText(Int(count)) }
+}
+
+@_cdecl("azookey_move_cursor")
+public func azookey_move_cursor(_ engine: OpaquePointer?, _ offset: Int32) {
+    withEngine(engine, isEdit: true) { $0.moveCursor(Int(offset)) }
+}
+
+@_cdecl("azookey_clear_text")
+public func azookey_clear_text(_ engine: OpaquePointer?) {
+    withEngine(engine, isEdit: true) { $0.clearText() }
+}
+
+@_cdecl("azookey_shrink_text")
+public func azookey_shrink_text(_ engine: OpaquePointer?) {
+    withEngine(engine, isEdit: true) { $0.shrinkText() }
+}
+
+@_cdecl("azookey_apply_edits")
+public func azookey_apply_edits(_ engine: OpaquePointer?, _ ops: UnsafePointer<EditOp>?, _ count: Int32, _ out: UnsafeMutablePointer<ConversionResultView>?) -> Bool {
+    let buffer = UnsafeBufferPointer(start: ops, count: ops == nil ? 0 : max(Int(count), 0))
+    return withEngine(engine, isEdit: true) { engine in
+        engine.applyEdits(buffer)
+        guard let out = out else { return true }
+        guard let cache = engine.ensureConverted() else { return false }
+        cache.fill(&out.pointee)
+        return true
+    } ?? false
+}
+
+@_cdecl("azookey_get_result")
+public func azookey_get_result(_ engine: OpaquePointer?, _ out: UnsafeMutablePointer<ConversionResultView>?) -> Bool {
+    guard let out = out else { return false }
+    return withEngine(engine) { engine in
+        guard let cache = engine.ensureConverted() else { return false }
+        cache.fill(&out.pointee)
+        return true
+    } ?? false
+}
+
+@_cdecl("azookey_get_candidate_buffer")
+public func azookey_get_candidate_buffer(_ engine: OpaquePointer?, _ version: UInt32, _ out: UnsafeMutablePointer<CandidateBufferView>?) -> Bool {
+    guard let out = out, version == UInt32(CANDIDATE_BUFFER_VERSION) else { return false }
+    return withEngine(engine) { engine in
+        guard let cache = engine.ensureAllCandidates() else { return false }
+        cache.fill(&out.pointee)
+        return true
+    } ?? false
+}
+
+@_cdecl("azookey_get_candidate_page")
+public func azookey_get_candidate_page(_ engine: OpaquePointer?, _ offset: Int32, _ count: Int32, _ out: UnsafeMutablePointer<CandidateBufferView>?, _ hasMore: UnsafeMutablePointer<Bool>?) -> Bool {
+    guard let out = out else { return false }
+    return withEngine(engine) { engine in
+        guard let cache = engine.ensureCandidates(upTo: Int(offset) + Int(count)) else { return false }
+        let more = cache.fillPage(offset: Int(offset), count: Int(count), &out.pointee)
+        hasMore?.pointee = more
+        return true
+    } ?? false
+}
+
+@_cdecl("azookey_warm_up")
+public func azookey_warm_up(_ engine: OpaquePointer?, _ flags: UInt32) -> Bool {
+    resolveEngine(engine)?.warmUp(flags: flags) ?? false
+}
+
+@_cdecl("azookey_get_warm_up_progress")
+public func azookey_get_warm_up_progress(_ engine: OpaquePointer?, _ out: UnsafeMutablePointer<WarmUpProgress>?) -> Bool {
+    guard let engine = resolveEngine(engine), let out = out else { return false }
+    let progress = engine.warmUpProgress
+    out.pointee = WarmUpProgress(completed: Int32(progress.completed), total: Int32(progress.total), running: progress.running)
+    return true
+}
+
+@_cdecl("azookey_convert_async")
+public func azookey_convert_async(_ engine: OpaquePointer?, _ generation: UInt64, _ callback: ConversionCallback?, _ userData: UnsafeMutableRawPointer?) -> Bool {
+    guard let engine = resolveEngine(engine), let callback = callback else { return false }
+    let delivery = ConversionDelivery(callback: callback, userData: userData)
+    return engine.convertAsync(generation: generation) { cache in
+        var view = ConversionResultView()
+        cache.fill(&view)
+        delivery.callback(delivery.userData, generation, &view)
     }
-    
-    // Initialize converter
-    initialize(nil, nil)
-    
-    // Return a dummy handle (not nil to indicate success)
-    return UnsafeMutableRawPointer(bitPattern: 1)
 }
 
-@_cdecl("azookey_destroy")
-public func azookey_destroy(_ engine: UnsafeMutableRawPointer?) {
-    shutdown()
+@_cdecl("azookey_cancel_conversion")
+public func azookey_cancel_conversion(_ engine: OpaquePointer?, _ generation: UInt64) {
+    resolveEngine(engine)?.cancelConversion(upTo: generation)
+}
+
+@_cdecl("azookey_select_candidate")
+public func azookey_select_candidate(_ engine: OpaquePointer?, _ index: Int32) {
+    withEngine(engine, isEdit: true) { $0.selectCandidate(Int(index)) }
+}
+
+@_cdecl("azookey_set_zenzai_enabled")
+public func azookey_set_zenzai_enabled(_ engine: OpaquePointer?, _ enabled: Bool) {
+    withEngine(engine, isEdit: true) { $0.setZenzaiEnabled(enabled) }
+}
+
+@_cdecl("azookey_set_zenzai_inference_limit")
+public func azookey_set_zenzai_inference_limit(_ engine: OpaquePointer?, _ limit: Int32) {
+    withEngine(engine, isEdit: true) { $0.setZenzaiInferenceLimit(Int(limit)) }
 }
 
 @_cdecl("azookey_convert")
-public func azookey_convert(_ engine: UnsafeMutableRawPointer?, _ input: UnsafePointer<CChar>?) -> UnsafePointer<CChar>? {
+public func azookey_convert(_ engine: OpaquePointer?, _ input: UnsafePointer<CChar>?) -> UnsafePointer<CChar>? {
     guard let input = input else { return nil }
-    
-    // Clear existing text and append new input
-    clearText()
-    appendText(input)
-    
-    // Get conversion result
-    return getComposedText()
+    let inputString = String(cString: input)
+
+    return withEngine(engine, isEdit: true) { engine -> UnsafePointer<CChar>? in
+        // Apply only the difference from the current composition
+        engine.replaceText(with: inputString)
+
+        // Get conversion result
+        guard let cache = engine.ensureConverted() else { return nil }
+        return UnsafePointer(_strdup(cache.candidates.first?.text ?? ""))
+    } ?? nil
 }
 
 @_cdecl("azookey_free_string")
 public func azookey_free_string(_ str: UnsafePointer<CChar>?) {
     freeString(str)
-}
\ No newline at end of file
+}
@@ -0,0 +1,605 @@
+import Foundation
+import KanaKanjiConverterModuleWithDefaultDictionary
+import ffi
+
+/// Engine configuration
+struct EngineConfig {
+    var dictionaryPath: String = ""
+    var memoryPath: String = ""
+    var zenzaiEnabled: Bool = false
+    var zenzaiInferenceLimit: Int = 10
+    var zenzaiWeightPath: String = ""
+
+    /// Overwrite the fields present in a parsed config JSON object
+    mutating func apply(_ json: [String: Any]) {
+        if let dictPath = json["dictionaryPath"] as? String {
+            self.dictionaryPath = dictPath
+        }
+        if let memPath = json["memoryPath"] as? String {
+            self.memoryPath = memPath
+        }
+        if let zenzaiEnabled = json["zenzaiEnabled"] as? Bool {
+            self.zenzaiEnabled = zenzaiEnabled
+        }
+        if let zenzaiLimit = json["zenzaiInferenceLimit"] as? Int {
+            self.zenzaiInferenceLimit = zenzaiLimit
+        }
+        if let zenzaiWeight = json["zenzaiWeightPath"] as? String {
+            self.zenzaiWeightPath = zenzaiWeight
+        }
+    }
+}
+
+/// Read-only resources shared by every engine instance in the process.
+/// Dictionary stores are keyed by path so that engines using the same dictionary
+/// load the LOUDS/connection cost data only once.
+enum SharedResources {
+    private static let lock = NSLock()
+    nonisolated(unsafe) private static var dicdataStores: [String: DicdataStore] = [:]
+    nonisolated(unsafe) private static var textReplacer: TextReplacer?
+
+    /// Dictionary store for `path`; an empty path selects the bundled dictionary
+    static func dicdataStore(path: String) -> DicdataStore {
+        lock.withLock {
+            if let store = dicdataStores[path] {
+                return store
+            }
+            let store = if path.isEmpty {
+                DicdataStore.withDefaultDictionary()
+            } else {
+                DicdataStore(dictionaryURL: URL(fileURLWithPath: path))
+            }
+            dicdataStores[path] = store
+            return store
+        }
+    }
+
+    /// Decoded-entry cache counters summed over every dictionary store
+    static func dictionaryCacheStatistics() -> (hits: Int, misses: Int) {
+        let stores = lock.withLock { Array(dicdataStores.values) }
+        return stores.reduce(into: (hits: 0, misses: 0)) { total, store in
+            let statistics = store.loudstxtCacheStatistics()
+            total.hits += statistics.hits
+            total.misses += statistics.misses
+        }
+    }
+
+    static func resetDictionaryCacheStatistics() {
+        let stores = lock.withLock { Array(dicdataStores.values) }
+        for store in stores {
+            store.resetLoudstxtCacheStatistics()
+        }
+    }
+
+    /// Emoji replacer (reads the emoji table once per process)
+    static func emojiTextReplacer() -> TextReplacer {
+        lock.withLock {
+            if let textReplacer {
+                return textReplacer
+            }
+            let replacer = TextReplacer.withDefaultEmojiDictionary()
+            textReplacer = replacer
+            return replacer
+        }
+    }
+}
+
+/// Packed candidate records and their UTF-8 texts, as handed out through `CandidateBufferView`
+final class CandidateArena {
+    private let records: UnsafeMutablePointer<CandidateRecord>
+    private let blob: UnsafeMutableRawPointer
+    private let count: Int
+    private let blobLength: Int
+
+    /// Pack `candidates` into one record array and one UTF-8 blob
+    init(candidates: some Collection<Candidate>) {
+        let blobLength = candidates.reduce(0) { $0 + $1.text.utf8.count + 1 }
+        let blob = UnsafeMutableRawPointer.allocate(byteCount: max(blobLength, 1), alignment: 1)
+        let records = UnsafeMutablePointer<CandidateRecord>.allocate(capacity: max(candidates.count, 1))
+
+        var offset = 0
+        for (i, candidate) in candidates.enumerated() {
+            var text = candidate.text
+            let length = text.withUTF8 { utf8 in
+                if let base = utf8.baseAddress {
+                    (blob + offset).copyMemory(from: base, byteCount: utf8.count)
+                }
+                return utf8.count
+            }
+            blob.storeBytes(of: 0, toByteOffset: offset + length, as: UInt8.self)
+
+            let (composingCount, isSurfaceCount) = flatComposingCount(candidate.composingCount)
+            var flags: UInt32 = 0
+            if candidate.isLearningTarget {
+                flags |= UInt32(CANDIDATE_FLAG_LEARNING_TARGET)
+            }
+            if candidate.inputable {
+                flags |= UInt32(CANDIDATE_FLAG_INPUTABLE)
+            }
+            if isSurfaceCount {
+                flags |= UInt32(CANDIDATE_FLAG_SURFACE_COUNT)
+            }
+            records[i] = CandidateRecord(
+                offset: UInt32(offset),
+                length: UInt32(length),
+                rubyLength: Int32(candidate.rubyCount),
+                score: candidate.value,
+                composingCount: Int32(composingCount),
+                flags: flags
+            )
+            offset += length + 1
+        }
+
+        self.records = records
+        self.blob = blob
+        self.count = candidates.count
+        self.blobLength = blobLength
+    }
+
+    deinit {
+        self.records.deallocate()
+        self.blob.deallocate()
+    }
+
+    func fill(_ view: inout CandidateBufferView) {
+        view.version = UInt32(CANDIDATE_BUFFER_VERSION)
+        view.count = UInt32(self.count)
+        view.records = UnsafePointer(self.records)
+        view.text = UnsafePointer(self.blob.assumingMemoryBound(to: CChar.self))
+        view.textLength = UInt32(self.blobLength)
+    }
+}
+
+/// Result of a single conversion, kept until the next edit of `composingText`.
+/// Owns the C strings handed out through `ConversionResultView` and `CandidateBufferView`.
+///
+/// The conversion computes only the top candidates; the word candidates that follow them
+/// are appended on demand by `Engine.loadDeferredCandidates`.
+final class ConversionCache {
+    /// Candidates computed so far
+    private(set) var candidates: [Candidate]
+    /// Whether candidates after the top ones still have to be computed
+    private(set) var hasDeferredCandidates = true
+    let segments: [(text: String, rubyLength: Int)]
+    /// Number of top candidates exposed through `ConversionResultView`
+    private let topCount: Int
+    private let bestText: UnsafeMutablePointer<CChar>
+    private let candidateTexts: UnsafeMutablePointer<UnsafePointer<CChar>?>
+    private let segmentViews: UnsafeMutablePointer<SegmentView>
+    /// Buffer of all candidates, built on the first GetCandidateBuffer call
+    private var fullBuffer: CandidateArena?
+    /// Buffer of the last requested page
+    private var pageBuffer: CandidateArena?
+
+    init(candidates: [Candidate]) {
+        self.candidates = candidates
+        self.topCount = candidates.count
+
+        // Split the best candidate into clauses
+        var segments: [(text: String, rubyLength: Int)] = []
+        if let best = candidates.first {
+            var rest = best.data[...]
+            while !rest.isEmpty {
+                let clause = Candidate.makePrefixClauseCandidate(data: rest)
+                if clause.data.isEmpty {
+                    break
+                }
+                segments.append((clause.text, clause.rubyCount))
+                rest = rest.dropFirst(clause.data.count)
+            }
+        }
+        self.segments = segments
+
+        self.bestText = _strdup(candidates.first?.text ?? "")
+        self.candidateTexts = .allocate(capacity: max(candidates.count, 1))
+        for (i, candidate) in candidates.enumerated() {
+            self.candidateTexts[i] = UnsafePointer(_strdup(candidate.text))
+        }
+        self.segmentViews = .allocate(capacity: max(segments.count, 1))
+        for (i, segment) in segments.enumerated() {
+            self.segmentViews[i] = SegmentView(text: UnsafePointer(_strdup(segment.text)), rubyLength: Int32(segment.rubyLength))
+        }
+    }
+
+    deinit {
+        free(self.bestText)
+        for i in 0..<self.topCount {
+            free(UnsafeMutablePointer(mutating: self.candidateTexts[i]))
+        }
+        self.candidateTexts.deallocate()
+        for i in self.segments.indices {
+            free(UnsafeMutablePointer(mutating: self.segmentViews[i].text))
+        }
+        self.segmentViews.deallocate()
+    }
+
+    /// Append the candidates that follow the top ones
+    func appendDeferredCandidates(_ deferred: [Candidate]) {
+        self.candidates.append(contentsOf: deferred)
+        self.hasDeferredCandidates = false
+        self.fullBuffer = nil
+    }
+
+    func fill(_ view: inout ConversionResultView) {
+        view.bestText = UnsafePointer(self.bestText)
+        view.candidates = UnsafePointer(self.candidateTexts)
+        view.candidateCount = Int32(self.topCount)
+        view.segments = UnsafePointer(self.segmentViews)
+        view.segmentCount = Int32(self.segments.count)
+    }
+
+    /// Fill `view` with every candidate computed so far
+    func fill(_ view: inout CandidateBufferView) {
+        let buffer = self.fullBuffer ?? CandidateArena(candidates: self.candidates)
+        self.fullBuffer = buffer
+        buffer.fill(&view)
+    }
+
+    /// Fill `view` with candidates [offset, offset + count) and report whether more may follow
+    func fillPage(offset: Int, count: Int, _ view: inout CandidateBufferView) -> Bool {
+        let lower = min(max(offset, 0), self.candidates.count)
+        let upper = min(lower + max(count, 0), self.candidates.count)
+        let buffer = CandidateArena(candidates: self.candidates[lower..<upper])
+        self.pageBuffer = buffer
+        buffer.fill(&view)
+        return self.hasDeferredCandidates || upper < self.candidates.count
+    }
+}
+
+/// Collapse a ComposingCount into a single character count.
+/// Mixed counts are summed and reported as surface counts.
+private func flatComposingCount(_ count: ComposingCount) -> (count: Int, isSurfaceCount: Bool) {
+    switch count {
+    case .inputCount(let value):
+        return (value, false)
+    case .surfaceCount(let value):
+        return (value, true)
+    case .composite(let lhs, let rhs):
+        let l = flatComposingCount(lhs)
+        let r = flatComposingCount(rhs)
+        return (l.count + r.count, l.isSurfaceCount || r.isSurfaceCount)
+    }
+}
+
+/// One input context: composing state, converter and the cached conversion result.
+/// Calls on the same instance are serialized by `lock`; separate instances run independently
+/// and only share the read-only data in `SharedResources`.
+final class Engine: @unchecked Sendable {
+    let lock = NSLock()
+    /// Worker running asynchronous conversions of this engine
+    private let worker = DispatchQueue(label: "azookey-engine.conversion")
+    /// Guards `latestGeneration` and `pendingConversion`; never held while converting
+    private let asyncLock = NSLock()
+    private var latestGeneration: UInt64 = 0
+    private var pendingConversion: (generation: UInt64, cancellation: ConversionCancellation)?
+    /// Warm-up progress, guarded by `asyncLock`
+    private var warmUpCompleted = 0
+    private var warmUpTotal = 0
+    private var warmUpRunning = false
+    private(set) var config = EngineConfig()
+    private var converter: KanaKanjiConverter?
+    private var dicdataStore: DicdataStore?
+    private var composingText = ComposingText()
+    private var conversionCache: ConversionCache?
+    /// Conversion options built from `config`.
+    /// Rebuilt only when the configuration changes, never per keystroke.
+    private var options: ConvertRequestOptions?
+
+    init() {}
+
+    init(config: EngineConfig) {
+        self.config = config
+    }
+
+    // MARK: Configuration
+
+    func loadConfig(_ json: [String: Any]) {
+        config.apply(json)
+        rebuildOptions()
+    }
+
+    func initialize(dictionaryPath: String?, memoryPath: String?) {
+        if let dictionaryPath {
+            config.dictionaryPath = dictionaryPath
+        }
+        if let memoryPath {
+            config.memoryPath = memoryPath
+        }
+        let store = SharedResources.dicdataStore(path: config.dictionaryPath)
+        dicdataStore = store
+        converter = KanaKanjiConverter(dicdataStore: store)
+        composingText = ComposingText()
+        rebuildOptions()
+    }
+
+    func shutdown() {
+        converter = nil
+        dicdataStore = nil
+        composingText = ComposingText()
+        conversionCache = nil
+        options = nil
+    }
+
+    func setZenzaiEnabled(_ enabled: Bool) {
+        config.zenzaiEnabled = enabled
+        rebuildOptions()
+    }
+
+    func setZenzaiInferenceLimit(_ limit: Int) {
+        config.zenzaiInferenceLimit = limit
+        rebuildOptions()
+    }
+
+    /// Rebuild conversion options from the current config
+    private func rebuildOptions() {
+        var zenzaiMode: ConvertRequestOptions.ZenzaiMode = .off
+
+        if config.zenzaiEnabled, !config.zenzaiWeightPath.isEmpty {
+            let weightURL = URL(fileURLWithPath: config.zenzaiWeightPath)
+            zenzaiMode = .on(weight: weightURL, inferenceLimit: config.zenzaiInferenceLimit, personalizationMode: nil)
+        }
+
+        let memoryURL = config.memoryPath.isEmpty ? nil : URL(fileURLWithPath: config.memoryPath)
+
+        options = ConvertRequestOptions(
+            requireJapanesePrediction: true,
+            requireEnglishPrediction: false,
+            keyboardLanguage: .ja_JP,
+            learningType: memoryURL != nil ? .inputAndOutput : .nothing,
+            memoryDirectoryURL: memoryURL ?? URL(fileURLWithPath: NSTemporaryDirectory()),
+            sharedContainerURL: memoryURL ?? URL(fileURLWithPath: NSTemporaryDirectory()),
+            textReplacer: SharedResources.emojiTextReplacer(),
+            specialCandidateProviders: nil,
+            zenzaiMode: zenzaiMode,
+            metadata: nil
+        )
+        conversionCache = nil
+    }
+
+    /// Get conversion options
+    private func getOptions() -> ConvertRequestOptions {
+        if let options {
+            return options
+        }
+        rebuildOptions()
+        return options!
+    }
+
+    // MARK: Text composition
+
+    func appendText(_ input: String) {
+        // Use .direct for hiragana input from Mozc (not roman2kana)
+        composingText.insertAtCursorPosition(input, inputStyle: .direct)
+        conversionCache = nil
+    }
+
+    func removeText(_ count: Int) {
+        composingText.deleteBackwardFromCursorPosition(count: max(count, 0))
+        conversionCache = nil
+    }
+
+    func moveCursor(_ offset: Int) {
+        _ = composingText.moveCursorFromCursorPosition(count: offset)
+        conversionCache = nil
+    }
+
+    func clearText() {
+        composingText = ComposingText()
+        conversionCache = nil
+    }
+
+    func shrinkText() {
+        composingText.deleteForwardFromCursorPosition(count: 1)
+        conversionCache = nil
+    }
+
+    /// Make the composing text equal to `text` by editing only the part after the common prefix.
+    /// The converter then sees a small delta against its previous input and can take the
+    /// incremental lattice paths, and an unchanged text keeps the cached result.
+    func replaceText(with text: String) {
+        let current = composingText.convertTarget
+        if current == text, composingText.isAtEndIndex {
+            return
+        }
+        let commonCount = zip(current, text).prefix(while: { $0 == $1 }).count
+        _ = composingText.moveCursorFromCursorPosition(count: current.count - composingText.convertTargetCursorPosition)
+        composingText.deleteBackwardFromCursorPosition(count: current.count - commonCount)
+        // Use .direct for hiragana input from Mozc (not roman2kana)
+        composingText.insertAtCursorPosition(String(text.dropFirst(commonCount)), inputStyle: .direct)
+        conversionCache = nil
+    }
+
+    /// Apply a batch of edits to the composing text; the conversion cache is dropped once
+    func applyEdits(_ ops: UnsafeBufferPointer<EditOp>) {
+        for op in ops {
+            switch op.kind {
+            case Int32(EDIT_OP_APPEND):
+                guard let text = op.text else { continue }
+                // Use .direct for hiragana input from Mozc (not roman2kana)
+                composingText.insertAtCursorPosition(String(cString: text), inputStyle: .direct)
+            case Int32(EDIT_OP_DELETE_BACKWARD):
+                composingText.deleteBackwardFromCursorPosition(count: max(Int(op.count), 0))
+            case Int32(EDIT_OP_DELETE_FORWARD):
+                composingText.deleteForwardFromCursorPosition(count: max(Int(op.count), 0))
+            case Int32(EDIT_OP_MOVE_CURSOR):
+                _ = composingText.moveCursorFromCursorPosition(count: Int(op.count))
+            case Int32(EDIT_OP_CLEAR):
+                composingText = ComposingText()
+            default:
+                // Unknown kinds are skipped so that newer callers keep working
+                continue
+            }
+        }
+        conversionCache = nil
+    }
+
+    // MARK: Conversion
+
+    /// Run the conversion for the current composing text, reusing the cached result if nothing changed.
+    /// Returns nil when `cancellation` fires; a cancelled result is never cached.
+    func ensureConverted(cancellation: ConversionCancellation? = nil) -> ConversionCache? {
+        if let cache = conversionCache {
+            return cache
+        }
+        guard let conv = converter else { return nil }
+
+        let result = conv.requestCandidates(composingText, options: getOptions(), cancellation: cancellation, deferWordCandidates: true)
+        if cancellation?.isCancelled == true {
+            return nil
+        }
+        let cache = ConversionCache(candidates: result.mainResults)
+        conversionCache = cache
+        return cache
+    }
+
+    /// Compute the candidates that follow the top ones, if not done yet
+    private func loadDeferredCandidates(_ cache: ConversionCache) {
+        guard cache.hasDeferredCandidates, let conv = converter else { return }
+        let deferred = conv.requestDeferredCandidates(composingText, mainResults: cache.candidates, options: getOptions())
+        cache.appendDeferredCandidates(deferred)
+    }
+
+    /// Conversion result with every candidate computed
+    func ensureAllCandidates() -> ConversionCache? {
+        guard let cache = ensureConverted() else { return nil }
+        loadDeferredCandidates(cache)
+        return cache
+    }
+
+    /// Conversion result with at least the first `end` candidates computed, if that many exist
+    func ensureCandidates(upTo end: Int) -> ConversionCache? {
+        guard let cache = ensureConverted() else { return nil }
+        if end > cache.candidates.count {
+            loadDeferredCandidates(cache)
+        }
+        return cache
+    }
+
+    // MARK: Asynchronous conversion
+
+    /// Queue a conversion of the current composing text on the worker.
+    /// Any older request is cancelled; `deliver` runs on the worker only if `generation`
+    /// is still the latest request when the conversion finishes.
+    /// Returns false if a newer generation has already been requested.
+    func convertAsync(generation: UInt64, deliver: @escaping @Sendable (ConversionCache) -> Void) -> Bool {
+        let cancellation = ConversionCancellation()
+        let accepted = asyncLock.withLock {
+            guard generation >= latestGeneration else { return false }
+            pendingConversion?.cancellation.cancel()
+            latestGeneration = generation
+            pendingConversion = (generation, cancellation)
+            return true
+        }
+        guard accepted else { return false }
+
+        worker.async { [self] in
+            // Skip requests superseded before they started
+            guard !cancellation.isCancelled else { return }
+            let cache = lock.withLock {
+                ensureConverted(cancellation: cancellation)
+            }
+            let isLatest = asyncLock.withLock {
+                guard pendingConversion?.generation == generation, !cancellation.isCancelled else { return false }
+                pendingConversion = nil
+                return true
+            }
+            if isLatest, let cache {
+                deliver(cache)
+            }
+        }
+        return true
+    }
+
+    /// Cancel the pending asynchronous conversion if its generation is `generation` or older.
+    /// Edits call this before taking `lock` so that they never wait for stale work.
+    func cancelConversion(upTo generation: UInt64 = .max) {
+        asyncLock.withLock {
+            if let pendingConversion, pendingConversion.generation <= generation {
+                pendingConversion.cancellation.cancel()
+            }
+        }
+    }
+
+    func selectCandidate(_ index: Int) {
+        guard let cache = conversionCache else { return }
+        if index >= cache.candidates.count {
+            loadDeferredCandidates(cache)
+        }
+        guard cache.candidates.indices.contains(index) else { return }
+
+        // Apply the selected candidate
+        converter?.setCompletedData(cache.candidates[index])
+
+        // Clear composing text after selection
+        composingText = ComposingText()
+        conversionCache = nil
+    }
+
+    // MARK: Warm-up
+
+    /// First characters whose LOUDS shards are preloaded (the katakana block)
+    private static let warmUpLOUDSQueries: [String] = (UInt32(0x30A1)...UInt32(0x30F4)).compactMap { Unicode.Scalar($0).map { String(Character($0)) } } + ["ー"]
+
+    /// Start loading the data the first conversion would otherwise load lazily.
+    /// Runs on a background thread; `warmUpProgress` reports how far it got.
+    /// Returns false when the engine is not initialized or a warm-up is already running.
+    /// Call without holding `lock`.
+    func warmUp(flags: UInt32) -> Bool {
+        let (store, zenzaiWeightPath) = lock.withLock { (dicdataStore, config.zenzaiWeightPath) }
+        guard let store else { return false }
+
+        var steps: [() -> Void] = []
+        if flags & UInt32(WARMUP_LOUDS) != 0 {
+            for query in Self.warmUpLOUDSQueries {
+                steps.append { store.preloadLOUDS(query: query) }
+            }
+        }
+        if flags & UInt32(WARMUP_CONNECTION_COSTS) != 0 {
+            for former in 0..<store.connectionCostRowCount {
+                steps.append { store.preloadConnectionCosts(former: former) }
+            }
+        }
+        if flags & UInt32(WARMUP_EMOJI) != 0 {
+            steps.append { _ = SharedResources.emojiTextReplacer() }
+        }
+        if flags & UInt32(WARMUP_ZENZAI) != 0, !zenzaiWeightPath.isEmpty {
+            let weightURL = URL(fileURLWithPath: zenzaiWeightPath)
+            steps.append { [self] in
+                // The converter is not thread-safe; this step waits for conversions and blocks them while loading
+                lock.withLock {
+                    _ = converter?.warmUpZenzai(weightURL: weightURL)
+                }
+            }
+        }
+
+        let started = asyncLock.withLock {
+            guard !warmUpRunning else { return false }
+            warmUpRunning = true
+            warmUpCompleted = 0
+            warmUpTotal = steps.count
+            return true
+        }
+        guard started else { return false }
+
+        let work = WarmUpWork(steps: steps)
+        DispatchQueue.global(qos: .utility).async { [self] in
+            for step in work.steps {
+                step()
+                asyncLock.withLock { warmUpCompleted += 1 }
+            }
+            asyncLock.withLock { warmUpRunning = false }
+        }
+        return true
+    }
+
+    /// Steps done, total steps and whether a warm-up is still running
+    var warmUpProgress: (completed: Int, total: Int, running: Bool) {
+        asyncLock.withLock { (warmUpCompleted, warmUpTotal, warmUpRunning) }
+    }
+}
+
+/// Warm-up steps handed to the background queue.
+/// The steps only touch lock-protected state (DicdataStore caches, SharedResources, Engine.lock).
+private struct WarmUpWork: @unchecked Sendable {
+    let steps: [() -> Void]
+}
@@ -8,6 +8,61 @@
 extern "C" {
 #endif
 
+// Conversion result views
+// All pointers are owned by the engine and stay valid until the next edit
+// (text composition, selection, or settings change). Do not free them.
+typedef struct {
+    const char* text;       // Converted text of the segment (UTF-8)
+    int32_t rubyLength;     // Number of reading characters the segment covers
+} SegmentView;
+
+typedef struct {
+    const char* bestText;               // Best candidate (UTF-8)
+    const char* const* candidates;      // Candidate texts (UTF-8), candidateCount entries
+    int32_t candidateCount;
+    const SegmentView* segments;        // Segments of the best candidate, segmentCount entries
+    int32_t segmentCount;
+} ConversionResultView;
+
+// Binary candidate buffer
+// Layout of the buffer returned by GetCandidateBuffer. Bump the version when
+// the record layout changes; the engine refuses versions it does not know.
+#define CANDIDATE_BUFFER_VERSION 1
+
+#define CANDIDATE_FLAG_LEARNING_TARGET 0x1  // Selecting the candidate updates the learning memory
+#define CANDIDATE_FLAG_INPUTABLE       0x2  // The candidate text can be typed as-is
+#define CANDIDATE_FLAG_SURFACE_COUNT   0x4  // composingCount is in surface characters, not input characters
+
+typedef struct {
+    uint32_t offset;            // Byte offset of the text in CandidateBufferView.text
+    uint32_t length;            // Byte length of the text, excluding the terminating NUL
+    int32_t rubyLength;         // Number of reading characters the candidate covers
+    float score;                // Conversion score (higher is better)
+    int32_t composingCount;     // Number of composing characters consumed when selected
+    uint32_t flags;             // CANDIDATE_FLAG_* bits
+} CandidateRecord;
+
+typedef struct {
+    uint32_t version;                   // CANDIDATE_BUFFER_VERSION the buffer was written with
+    uint32_t count;                     // Number of records
+    const CandidateRecord* records;     // count entries, in candidate order
+    const char* text;                   // UTF-8 blob; every entry is NUL-terminated
+    uint32_t textLength;                // Size of the blob in bytes
+} CandidateBufferView;
+
+// Batched edits
+#define EDIT_OP_APPEND          0   // Insert `text` at the cursor
+#define EDIT_OP_DELETE_BACKWARD 1   // Delete `count` characters left of the cursor
+#define EDIT_OP_DELETE_FORWARD  2   // Delete `count` characters right of the cursor
+#define EDIT_OP_MOVE_CURSOR     3   // Move the cursor by `count` (negative moves left)
+#define EDIT_OP_CLEAR           4   // Clear the composing text
+
+typedef struct {
+    int32_t kind;           // EDIT_OP_*
+    int32_t count;          // Character count or cursor offset (unused by APPEND and CLEAR)
+    const char* text;       // UTF-8 text for APPEND, otherwise NULL
+} EditOp;
+
 // Configuration and initialization
 void LoadConfig(const char* configPath);
 void Initialize(const char* dictionaryPath, const char* memoryPath);
@@ -18,10 +73,29 @@ void AppendText(const char* input);
 void RemoveText(int count);
 void MoveCursor(int offset);
 void ClearText(void);
+// Applies `count` edits in order, then converts once and fills `out`.
+// Pass NULL as `out` to skip the conversion. Returns false when the engine is
+// not initialized (the edits are still applied).
+bool ApplyEdits(const EditOp* ops, int count, ConversionResultView* out);
 
 // Conversion
+// Runs the conversion once per edit and fills `out` with the cached result.
+// `candidates` holds only the top candidates; use GetCandidatePage for the rest.
+// Returns false when the engine is not initialized.
+bool Convert(ConversionResultView* out);
 const char* GetComposedText(void);
+// Legacy JSON array of candidate texts; free with FreeString.
+// Prefer GetCandidateBuffer, which needs neither parsing nor freeing.
 const char* GetCandidates(void);
+// Fills `out` with the packed candidate buffer of the current conversion.
+// The buffer is owned by the engine and stays valid until the next edit.
+// Returns false when the engine is not initialized or `version` is unsupported.
+bool GetCandidateBuffer(uint32_t version, CandidateBufferView* out);
+// Fills `out` with candidates [offset, offset + count). Candidates after the top
+// ones are computed only when a page reaches past them. `hasMore` (optional) is
+// set when further candidates may follow. The page stays valid until the next
+// page request or edit.
+bool GetCandidatePage(int offset, int count, CandidateBufferView* out, bool* hasMore);
 void SelectCandidate(int index);
 void ShrinkText(void);
 void ExpandText(void);
@@ -33,9 +107,104 @@ void SetContext(const char* precedingText);
 void SetZenzaiEnabled(bool enabled);
 void SetZenzaiInferenceLimit(int limit);
 
+// Warm-up
+// Data loaded in the background by WarmUp so that the first keystroke does not pay for it
+#define WARMUP_LOUDS            0x1     // Dictionary shards of the katakana first characters
+#define WARMUP_CONNECTION_COSTS 0x2     // All connection-cost rows
+#define WARMUP_EMOJI            0x4     // Emoji replacement table
+#define WARMUP_ZENZAI           0x8     // Zenzai model, with one dummy decode (if a weight path is set)
+#define WARMUP_ALL              0xF
+
+typedef struct {
+    int32_t completed;      // Steps finished
+    int32_t total;          // Steps scheduled by the last WarmUp call
+    bool running;           // False once every step has finished
+} WarmUpProgress;
+
+// Starts the warm-up on a background thread and returns immediately.
+// Returns false when the engine is not initialized or a warm-up is already running.
+bool WarmUp(uint32_t flags);
+bool GetWarmUpProgress(WarmUpProgress* out);
+
+// Diagnostics
+// Number of dictionary/data files opened by the converter since the last reset.
+// Used to check that the per-keystroke path does no file I/O.
+int64_t GetFileAccessCount(void);
+void ResetFileAccessCount(void);
+
+// Latency statistics, process-wide. Times are monotonic nanoseconds; percentiles
+// come from log-scale histograms and are accurate to about 20%.
+#define ENGINE_STAGE_REQUEST_CANDIDATES 0   // Whole conversion (requestCandidates)
+#define ENGINE_STAGE_DICTIONARY_LOOKUP  1   // DicdataStore.lookupDicdata
+#define ENGINE_STAGE_LATTICE            2   // kana2lattice_* (includes dictionary lookup)
+#define ENGINE_STAGE_ZENZAI_DECODE      3   // llama_decode in ZenzContext.get_logits
+#define ENGINE_STAGE_FFI                4   // Exported functions, conversion included
+#define ENGINE_STAGE_COUNT              5
+
+typedef struct {
+    uint64_t count;
+    uint64_t totalNs;
+    uint64_t p50Ns;
+    uint64_t p99Ns;
+    uint64_t maxNs;
+} StageStats;
+
+typedef struct {
+    StageStats stages[ENGINE_STAGE_COUNT];  // Indexed by ENGINE_STAGE_*
+    int64_t fileAccessCount;                // Same as GetFileAccessCount()
+    int64_t dictionaryCacheHits;            // Dictionary entries served from the decoded-entry cache
+    int64_t dictionaryCacheMisses;          // Dictionary entries read and decoded from .loudstxt3
+} EngineStats;
+
+bool GetEngineStats(EngineStats* out);
+// Clears the latency statistics, the file access count and the cache counters
+void ResetEngineStats(void);
+
 // Memory management
 void FreeString(const char* str);
 
+// Handle API
+// Each handle owns its own composing state and converter; dictionary data is
+// shared between handles. Different handles may be used from different threads
+// in parallel. Views filled by a handle stay valid until the next edit on it.
+typedef struct azookey_engine azookey_engine_t;
+
+azookey_engine_t* azookey_create(const char* configJson);
+void azookey_destroy(azookey_engine_t* engine);
+void azookey_append_text(azookey_engine_t* engine, const char* input);
+void azookey_remove_text(azookey_engine_t* engine, int count);
+void azookey_move_cursor(azookey_engine_t* engine, int offset);
+void azookey_clear_text(azookey_engine_t* engine);
+void azookey_shrink_text(azookey_engine_t* engine);
+bool azookey_apply_edits(azookey_engine_t* engine, const EditOp* ops, int count, ConversionResultView* out);
+bool azookey_get_result(azookey_engine_t* engine, ConversionResultView* out);
+bool azookey_get_candidate_buffer(azookey_engine_t* engine, uint32_t version, CandidateBufferView* out);
+bool azookey_get_candidate_page(azookey_engine_t* engine, int offset, int count, CandidateBufferView* out, bool* hasMore);
+bool azookey_warm_up(azookey_engine_t* engine, uint32_t flags);
+bool azookey_get_warm_up_progress(azookey_engine_t* engine, WarmUpProgress* out);
+
+// Asynchronous conversion
+// Called on the engine's worker thread. `result` is valid only during the call;
+// use azookey_get_result afterwards to read the same (cached) result again.
+typedef void (*ConversionCallback)(void* userData, uint64_t generation, const ConversionResultView* result);
+
+// Converts the current composing text on the engine's worker and cancels any older
+// request. Generations must not decrease; only the latest one is delivered, and any
+// edit on the handle cancels pending work. Returns false if `generation` is stale.
+bool azookey_convert_async(azookey_engine_t* engine, uint64_t generation, ConversionCallback callback, void* userData);
+// Cancels the pending conversion if its generation is `generation` or older.
+// Cancellation also interrupts Zenzai inference in progress.
+void azookey_cancel_conversion(azookey_engine_t* engine, uint64_t generation);
+void azookey_select_candidate(azookey_engine_t* engine, int index);
+void azookey_set_zenzai_enabled(azookey_engine_t* engine, bool enabled);
+void azookey_set_zenzai_inference_limit(azookey_engine_t* engine, int limit);
+// Replaces the composing text with `input` and returns the best candidate.
+// Only the part after the common prefix with the current text is edited, so
+// successive calls reuse the previous lattice.
+// Free the result with azookey_free_string.
+const char* azookey_convert(azookey_engine_t* engine, const char* input);
+void azookey_free_string(const char* str);
+
 #ifdef __cplusplus
 }
 #endif